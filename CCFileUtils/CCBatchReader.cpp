@@ -0,0 +1,523 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "platform/CCBatchReader.h"
+
+#include "base/ccMacros.h"
+
+#include <thread>
+#include <mutex>
+#include <system_error>
+#include <new>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+
+#if defined(__linux__) && !defined(__ANDROID__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define CC_USE_IO_URING 1
+#endif
+#endif
+
+#if CC_USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+NS_CC_BEGIN
+
+// files opened at the same time by one read() call, to stay well below the descriptor limit
+static const size_t OPEN_FILES_MAX = 256;
+// threads of the fallback pool, the calling thread included
+static const unsigned int READ_THREADS_MAX = 8;
+
+static unsigned char* readWholeFile(const std::string& path, size_t& size)
+{
+    size = 0;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || (st.st_mode & S_IFMT) != S_IFREG || st.st_size <= 0)
+        return nullptr;
+    FILE* fp = fopen(path.c_str(), "rb");
+    if (!fp)
+        return nullptr;
+    unsigned char* buffer = (unsigned char*)malloc((size_t)st.st_size + 1);
+    if (!buffer)
+    {
+        fclose(fp);
+        return nullptr;
+    }
+    size = fread(buffer, 1, (size_t)st.st_size, fp);
+    fclose(fp);
+    // the file may have shrunk since stat()
+    buffer[size] = '\0';
+    if (size == 0)
+    {
+        free(buffer);
+        buffer = nullptr;
+    }
+    return buffer;
+}
+
+#if CC_USE_IO_URING
+
+namespace {
+
+/** A submission/completion ring pair, one per reading thread. */
+struct Ring
+{
+    int fd = -1;
+    unsigned int entries = 0;
+
+    void* sqPtr = nullptr;
+    size_t sqSize = 0;
+    void* cqPtr = nullptr;
+    size_t cqSize = 0;
+    io_uring_sqe* sqes = nullptr;
+    size_t sqesSize = 0;
+
+    unsigned int* sqHead = nullptr;
+    unsigned int* sqTail = nullptr;
+    unsigned int* sqMask = nullptr;
+    unsigned int* sqArray = nullptr;
+    unsigned int* cqHead = nullptr;
+    unsigned int* cqTail = nullptr;
+    unsigned int* cqMask = nullptr;
+    io_uring_cqe* cqes = nullptr;
+
+    ~Ring() { close(); }
+
+    bool open(unsigned int depth)
+    {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = (int)syscall(__NR_io_uring_setup, depth, &params);
+        if (fd < 0)
+            return false;
+        entries = params.sq_entries;
+
+        sqSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+        cqSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (singleMap)
+            sqSize = cqSize = std::max(sqSize, cqSize);
+
+        sqPtr = mmap(nullptr, sqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (sqPtr == MAP_FAILED)
+        {
+            sqPtr = nullptr;
+            close();
+            return false;
+        }
+        if (singleMap)
+        {
+            cqPtr = sqPtr;
+        }
+        else
+        {
+            cqPtr = mmap(nullptr, cqSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (cqPtr == MAP_FAILED)
+            {
+                cqPtr = nullptr;
+                close();
+                return false;
+            }
+        }
+        sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqesPtr = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (sqesPtr == MAP_FAILED)
+        {
+            close();
+            return false;
+        }
+        sqes = (io_uring_sqe*)sqesPtr;
+
+        char* sq = (char*)sqPtr;
+        sqHead = (unsigned int*)(sq + params.sq_off.head);
+        sqTail = (unsigned int*)(sq + params.sq_off.tail);
+        sqMask = (unsigned int*)(sq + params.sq_off.ring_mask);
+        sqArray = (unsigned int*)(sq + params.sq_off.array);
+        char* cq = (char*)cqPtr;
+        cqHead = (unsigned int*)(cq + params.cq_off.head);
+        cqTail = (unsigned int*)(cq + params.cq_off.tail);
+        cqMask = (unsigned int*)(cq + params.cq_off.ring_mask);
+        cqes = (io_uring_cqe*)(cq + params.cq_off.cqes);
+
+        // IORING_OP_READ needs Linux 5.6, which is also the first kernel able to answer this probe
+        size_t probeSize = sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op);
+        io_uring_probe* probe = (io_uring_probe*)calloc(1, probeSize);
+        bool supported = syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) >= 0
+            && probe->last_op >= IORING_OP_READ
+            && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+        free(probe);
+        if (!supported)
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (sqes)
+            munmap(sqes, sqesSize);
+        if (cqPtr && cqPtr != sqPtr)
+            munmap(cqPtr, cqSize);
+        if (sqPtr)
+            munmap(sqPtr, sqSize);
+        if (fd >= 0)
+            ::close(fd);
+        fd = -1;
+        entries = 0;
+        sqes = nullptr;
+        sqPtr = cqPtr = nullptr;
+    }
+
+    void queueRead(int fileFd, void* buf, unsigned int len, unsigned long long offset, unsigned long long userData)
+    {
+        unsigned int tail = *sqTail;
+        unsigned int index = tail & *sqMask;
+        io_uring_sqe* sqe = &sqes[index];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = IORING_OP_READ;
+        sqe->fd = fileFd;
+        sqe->addr = (unsigned long long)(uintptr_t)buf;
+        sqe->len = len;
+        sqe->off = offset;
+        sqe->user_data = userData;
+        sqArray[index] = index;
+        __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+    }
+
+    int enter(unsigned int toSubmit, unsigned int minComplete)
+    {
+        int ret;
+        do
+        {
+            ret = (int)syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, IORING_ENTER_GETEVENTS, nullptr, 0);
+        } while (ret < 0 && errno == EINTR);
+        return ret;
+    }
+};
+
+thread_local Ring t_ring;
+
+} // namespace
+
+bool BatchReader::readWithUring(std::vector<Request>& requests, size_t first, size_t count)
+{
+    unsigned int depth = _queueDepth;
+    if (t_ring.fd < 0 || t_ring.entries < depth)
+    {
+        t_ring.close();
+        if (!t_ring.open(depth))
+            return false;
+    }
+
+    struct File
+    {
+        int fd;
+        size_t offset;
+        bool reading;
+    };
+    std::vector<File> files(count);
+    std::vector<size_t> ready;
+    ready.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Request& request = requests[first + i];
+        File& file = files[i];
+        file.offset = 0;
+        file.reading = false;
+        file.fd = ::open(request.path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat st;
+        if (file.fd >= 0 && fstat(file.fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        {
+            request.buffer = (unsigned char*)malloc((size_t)st.st_size + 1);
+            if (request.buffer)
+            {
+                request.size = st.st_size;
+                ready.push_back(i);
+            }
+        }
+    }
+
+    // sqe->len is 32 bits, larger files are read in several pieces
+    static const size_t READ_SIZE_MAX = 1 << 30;
+    auto queueRead = [&](size_t i) {
+        Request& request = requests[first + i];
+        File& file = files[i];
+        file.reading = true;
+        t_ring.queueRead(file.fd, request.buffer + file.offset,
+            (unsigned int)std::min(request.size - file.offset, READ_SIZE_MAX), file.offset, i);
+    };
+
+    size_t next = 0;
+    unsigned int inflight = 0;  // queued or submitted
+    unsigned int queued = 0;    // not submitted yet
+    bool failed = false;
+    while (next < ready.size() || inflight > 0)
+    {
+        for (; next < ready.size() && inflight < t_ring.entries; ++next, ++inflight, ++queued)
+            queueRead(ready[next]);
+        if (t_ring.enter(queued, 1) < 0)
+        {
+            failed = true;
+            break;
+        }
+        queued = 0;
+
+        unsigned int head = *t_ring.cqHead;
+        unsigned int tail = __atomic_load_n(t_ring.cqTail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            io_uring_cqe* cqe = &t_ring.cqes[head & *t_ring.cqMask];
+            size_t i = (size_t)cqe->user_data;
+            int res = cqe->res;
+            Request& request = requests[first + i];
+            File& file = files[i];
+            file.reading = false;
+            if (res > 0)
+                file.offset += res;
+            if (res == -EINTR || res == -EAGAIN || (res > 0 && file.offset < request.size))
+            {
+                // short read, the rest goes into the entry this completion just freed
+                queueRead(i);
+                ++queued;
+                continue;
+            }
+            --inflight;
+            // the file may have shrunk since fstat()
+            request.size = res < 0 ? 0 : file.offset;
+            if (request.size > 0)
+            {
+                request.buffer[request.size] = '\0';
+            }
+            else
+            {
+                free(request.buffer);
+                request.buffer = nullptr;
+            }
+        }
+        __atomic_store_n(t_ring.cqHead, head, __ATOMIC_RELEASE);
+    }
+
+    if (failed)
+    {
+        // submitted reads may still land in their buffers : those are abandoned rather than freed
+        t_ring.close();
+        for (size_t i : ready)
+        {
+            Request& request = requests[first + i];
+            if (!files[i].reading)
+                free(request.buffer);
+            request.buffer = nullptr;
+            request.size = 0;
+        }
+    }
+    for (auto& file : files)
+        if (file.fd >= 0)
+            ::close(file.fd);
+    if (failed)
+        readWithThreads(requests, first, count);
+    return true;
+}
+
+#else
+
+bool BatchReader::readWithUring(std::vector<Request>& requests, size_t first, size_t count)
+{
+    return false;
+}
+
+#endif // CC_USE_IO_URING
+
+BatchReader* BatchReader::s_sharedBatchReader = nullptr;
+static std::mutex s_instanceMutex;
+
+BatchReader* BatchReader::getInstance()
+{
+    std::lock_guard<std::mutex> guard(s_instanceMutex);
+    if (s_sharedBatchReader == nullptr)
+        s_sharedBatchReader = new (std::nothrow) BatchReader();
+    return s_sharedBatchReader;
+}
+
+void BatchReader::destroyInstance()
+{
+    std::lock_guard<std::mutex> guard(s_instanceMutex);
+    CC_SAFE_DELETE(s_sharedBatchReader);
+}
+
+/** Files of one readWithThreads() call, read by the calling thread and the pool threads which join it. */
+struct BatchReader::Batch
+{
+    std::vector<Request>* requests;
+    size_t first;
+    size_t count;
+    std::atomic<size_t> next;       // next file to read
+    // guarded by _poolMutex
+    unsigned int helpersWanted;     // pool threads which may still join
+    unsigned int helpers;           // pool threads reading it
+    std::condition_variable done;
+
+    /** Reads the next file, if any is left. */
+    bool readNext()
+    {
+        size_t i = next++;
+        if (i >= count)
+            return false;
+        Request& request = (*requests)[first + i];
+        request.buffer = readWholeFile(request.path, request.size);
+        return true;
+    }
+};
+
+BatchReader::BatchReader()
+: _queueDepth(32)
+#if CC_USE_IO_URING
+, _uringAvailable(true)
+#else
+, _uringAvailable(false)
+#endif
+, _poolStarted(false)
+, _stopPool(false)
+{
+}
+
+BatchReader::~BatchReader()
+{
+    {
+        std::lock_guard<std::mutex> guard(_poolMutex);
+        _stopPool = true;
+    }
+    _poolCondition.notify_all();
+    for (auto& thread : _threads)
+        thread.join();
+}
+
+void BatchReader::read(std::vector<Request>& requests)
+{
+    for (auto& request : requests)
+    {
+        request.buffer = nullptr;
+        request.size = 0;
+    }
+
+    for (size_t first = 0; first < requests.size(); first += OPEN_FILES_MAX)
+    {
+        size_t count = std::min(requests.size() - first, OPEN_FILES_MAX);
+        // a kernel without io_uring (or with it disabled) won't get it back, stop trying
+        if (!_uringAvailable || !readWithUring(requests, first, count))
+        {
+            _uringAvailable = false;
+            readWithThreads(requests, first, count);
+        }
+    }
+}
+
+void BatchReader::startPool()
+{
+    // called with _poolMutex held
+    _poolStarted = true;
+    for (unsigned int i = 1; i < READ_THREADS_MAX; ++i)
+    {
+        try
+        {
+            _threads.push_back(std::thread(&BatchReader::poolLoop, this));
+        }
+        catch (const std::system_error&)
+        {
+            break;  // fewer helpers, the calling threads still read their own batches
+        }
+    }
+}
+
+void BatchReader::poolLoop()
+{
+    std::unique_lock<std::mutex> lock(_poolMutex);
+    for (;;)
+    {
+        _poolCondition.wait(lock, [this] { return _stopPool || !_batches.empty(); });
+        if (_stopPool)
+            return;
+
+        Batch* batch = _batches.front();
+        if (--batch->helpersWanted == 0)
+            _batches.pop_front();
+        ++batch->helpers;
+        lock.unlock();
+        while (batch->readNext())
+            ;
+        lock.lock();
+        if (--batch->helpers == 0)
+            batch->done.notify_one();
+    }
+}
+
+void BatchReader::readWithThreads(std::vector<Request>& requests, size_t first, size_t count)
+{
+    Batch batch;
+    batch.requests = &requests;
+    batch.first = first;
+    batch.count = count;
+    batch.next = 0;
+    batch.helpers = 0;
+    batch.helpersWanted = 0;
+
+    unsigned int threadCount = std::min((unsigned int)std::min<size_t>(count, _queueDepth), READ_THREADS_MAX);
+    bool shared = false;
+    if (threadCount > 1)
+    {
+        std::lock_guard<std::mutex> guard(_poolMutex);
+        if (!_poolStarted)
+            startPool();
+        batch.helpersWanted = std::min(threadCount - 1, (unsigned int)_threads.size());
+        shared = batch.helpersWanted > 0;
+        if (shared)
+            _batches.push_back(&batch);
+    }
+    if (shared)
+        _poolCondition.notify_all();
+
+    while (batch.readNext())
+        ;
+
+    // every file is claimed : stop accepting helpers, and wait for those reading the last ones
+    std::unique_lock<std::mutex> lock(_poolMutex);
+    auto it = std::find(_batches.begin(), _batches.end(), &batch);
+    if (it != _batches.end())
+        _batches.erase(it);
+    batch.done.wait(lock, [&batch] { return batch.helpers == 0; });
+}
+
+NS_CC_END
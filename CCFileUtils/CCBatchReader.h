@@ -0,0 +1,127 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+#ifndef __CC_BATCHREADER_H__
+#define __CC_BATCHREADER_H__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "platform/CCPlatformMacros.h"
+
+NS_CC_BEGIN
+
+/**
+ * @addtogroup platform
+ * @{
+ */
+
+/**
+ *  Reads whole files in batches, keeping several reads in flight to keep the storage queues busy.
+ *
+ *  On Linux (not Android) the reads are submitted through io_uring when the kernel supports it,
+ *  otherwise a pool of threads, started on first use and kept until destroyInstance(), reads the
+ *  files in parallel. Used by the IO stage of FileLoader.
+ */
+class CC_DLL BatchReader
+{
+public:
+    enum class Backend
+    {
+        IoUring,
+        ThreadPool,
+    };
+
+    struct Request
+    {
+        std::string path;           // as returned by FileUtils::getSuitableFOpen()
+        unsigned char* buffer;      // out : malloc'd content followed by a '\0', nullptr on failure
+        size_t size;                // out : content size, without the '\0'
+    };
+
+    static BatchReader* getInstance();
+
+    /**
+     *  Stops the thread pool and destroys the instance. No read() may be in progress.
+     *  Called by FileUtils::destroyInstance(), after the FileLoader threads are stopped.
+     */
+    static void destroyInstance();
+
+    /**
+     *  Reads the requested files, blocking until all of them are done. Thread safe.
+     *  Empty or unreadable files are reported with a null buffer.
+     */
+    void read(std::vector<Request>& requests);
+
+    /**
+     *  Sets the maximum number of reads in flight.
+     *  @param depth Defaults to 32.
+     */
+    void setQueueDepth(unsigned int depth) { _queueDepth = depth > 0 ? depth : 1; }
+    unsigned int getQueueDepth() const { return _queueDepth; }
+
+    Backend getBackend() const { return _uringAvailable ? Backend::IoUring : Backend::ThreadPool; }
+
+    /**
+     *  Switches to the thread pool backend for good, e.g. to test or compare it. No read() may be in progress.
+     */
+    void useThreadPool() { _uringAvailable = false; }
+
+private:
+    struct Batch;
+
+    BatchReader();
+    ~BatchReader();
+
+    bool readWithUring(std::vector<Request>& requests, size_t first, size_t count);
+    void readWithThreads(std::vector<Request>& requests, size_t first, size_t count);
+    void startPool();
+    void poolLoop();
+
+    static BatchReader* s_sharedBatchReader;
+
+    std::atomic<unsigned int> _queueDepth;
+    std::atomic<bool> _uringAvailable;
+
+    // thread pool backend : batches still accepting helpers, in arrival order
+    std::mutex _poolMutex;
+    std::condition_variable _poolCondition;
+    std::deque<Batch*> _batches;
+    std::vector<std::thread> _threads;
+    bool _poolStarted;
+    bool _stopPool;
+};
+
+// end of support group
+/** @} */
+
+NS_CC_END
+
+#endif    // __CC_BATCHREADER_H__
@@ -0,0 +1,431 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "platform/CCCompiledPlist.h"
+
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <cstdlib>
+#include <algorithm>
+#include <unordered_map>
+
+#include "base/ccMacros.h"
+#include "platform/CCPlistWriter.h"
+
+NS_CC_BEGIN
+
+namespace {
+
+enum ValueType
+{
+    TYPE_FALSE = 0,
+    TYPE_TRUE = 1,
+    TYPE_INTEGER = 2,
+    TYPE_REAL = 3,
+    TYPE_STRING = 4,
+    TYPE_ARRAY = 5,
+    TYPE_DICT = 6,
+};
+
+const unsigned char MAGIC[4] = { 'c', 'c', 'p', 'l' };
+const uint32_t FORMAT_VERSION = 1;
+// deeper trees are taken for corrupted data rather than recursing further
+const int MAX_DEPTH = 256;
+
+class Reader
+{
+public:
+    Reader(const unsigned char* bytes, size_t size)
+    : _bytes(bytes)
+    , _size(size)
+    , _pos(0)
+    {
+    }
+
+    bool readHeader()
+    {
+        uint32_t version = 0;
+        uint32_t count = 0;
+        if (_size < sizeof(MAGIC) || memcmp(_bytes, MAGIC, sizeof(MAGIC)) != 0)
+            return false;
+        _pos = sizeof(MAGIC);
+        if (!read(version) || version != FORMAT_VERSION || !read(count) || count > remaining() / sizeof(uint32_t))
+            return false;
+        _strings.resize(count);
+        for (auto& str : _strings)
+        {
+            if (!read(str.length) || str.length > remaining())
+                return false;
+            str.chars = (const char*)_bytes + _pos;
+            _pos += str.length;
+        }
+        return true;
+    }
+
+    bool readType(unsigned char& type)
+    {
+        return read(type);
+    }
+
+    bool readValue(unsigned char type, Value& value, int depth)
+    {
+        switch (type)
+        {
+        case TYPE_FALSE:
+            value = Value(false);
+            return true;
+        case TYPE_TRUE:
+            value = Value(true);
+            return true;
+        case TYPE_INTEGER:
+            {
+                int32_t integer;
+                if (!read(integer))
+                    return false;
+                value = Value((int)integer);
+                return true;
+            }
+        case TYPE_REAL:
+            {
+                double real;
+                if (!read(real))
+                    return false;
+                value = Value(real);
+                return true;
+            }
+        case TYPE_STRING:
+            {
+                std::string str;
+                if (!readString(str))
+                    return false;
+                value = Value(std::move(str));
+                return true;
+            }
+        case TYPE_ARRAY:
+            value = Value(ValueVector());
+            return readArray(value.asValueVector(), depth + 1);
+        case TYPE_DICT:
+            value = Value(ValueMap());
+            return readDict(value.asValueMap(), depth + 1);
+        default:
+            return false;
+        }
+    }
+
+    bool readArray(ValueVector& array, int depth)
+    {
+        uint32_t count;
+        if (depth > MAX_DEPTH || !read(count))
+            return false;
+        // every value takes a byte at least, a corrupted count can't reserve more than the file size
+        array.reserve(std::min<size_t>(count, remaining()));
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            unsigned char type;
+            array.push_back(Value());
+            if (!readType(type) || !readValue(type, array.back(), depth))
+                return false;
+        }
+        return true;
+    }
+
+    bool readDict(ValueMap& dict, int depth)
+    {
+        uint32_t count;
+        if (depth > MAX_DEPTH || !read(count))
+            return false;
+        dict.reserve(std::min<size_t>(count, remaining()));
+        for (uint32_t i = 0; i < count; ++i)
+        {
+            std::string key;
+            unsigned char type;
+            if (!readString(key) || !readType(type))
+                return false;
+            // a key repeated in the source plist keeps its last value, as the XML parser does
+            if (!readValue(type, dict[std::move(key)], depth))
+                return false;
+        }
+        return true;
+    }
+
+private:
+    struct StringRef
+    {
+        const char* chars;
+        uint32_t length;
+    };
+
+    size_t remaining() const { return _size - _pos; }
+
+    template<typename T>
+    bool read(T& value)
+    {
+        if (remaining() < sizeof(T))
+            return false;
+        memcpy(&value, _bytes + _pos, sizeof(T));
+        _pos += sizeof(T);
+        return true;
+    }
+
+    bool readString(std::string& str)
+    {
+        uint32_t index;
+        if (!read(index) || index >= _strings.size())
+            return false;
+        str.assign(_strings[index].chars, _strings[index].length);
+        return true;
+    }
+
+    const unsigned char* _bytes;
+    size_t _size;
+    size_t _pos;
+    std::vector<StringRef> _strings;
+};
+
+class Encoder
+{
+public:
+    explicit Encoder(PlistWriter& writer)
+    : _writer(writer)
+    {
+    }
+
+    // first pass : the string table, each distinct key or string once
+    void collectValue(const Value& value)
+    {
+        switch (value.getType())
+        {
+        case Value::Type::STRING:
+            addString(value.asString());
+            break;
+        case Value::Type::VECTOR:
+            collectArray(value.asValueVector());
+            break;
+        case Value::Type::MAP:
+            collectDict(value.asValueMap());
+            break;
+        default:
+            break;
+        }
+    }
+
+    void collectArray(const ValueVector& array)
+    {
+        for (const auto& value : array)
+            collectValue(value);
+    }
+
+    void collectDict(const ValueMap& dict)
+    {
+        for (const auto& iter : dict)
+        {
+            if (!isEncodable(iter.second))
+                continue;
+            addString(iter.first);
+            collectValue(iter.second);
+        }
+    }
+
+    void writeHeader()
+    {
+        _writer.write(MAGIC, sizeof(MAGIC));
+        write(FORMAT_VERSION);
+        write((uint32_t)_strings.size());
+        for (const auto str : _strings)
+        {
+            write((uint32_t)str->size());
+            _writer.write(str->data(), str->size());
+        }
+    }
+
+    // second pass : the tree, strings replaced by their index
+    void writeValue(const Value& value)
+    {
+        switch (value.getType())
+        {
+        case Value::Type::BOOLEAN:
+            writeType(value.asBool() ? TYPE_TRUE : TYPE_FALSE);
+            break;
+        case Value::Type::INTEGER:
+            writeType(TYPE_INTEGER);
+            write((int32_t)value.asInt());
+            break;
+        case Value::Type::FLOAT:
+        case Value::Type::DOUBLE:
+            // through the text the XML writer prints, so both formats load the same number
+            writeType(TYPE_REAL);
+            write(std::atof(value.asString().c_str()));
+            break;
+        case Value::Type::STRING:
+            writeType(TYPE_STRING);
+            write(indexOf(value.asString()));
+            break;
+        case Value::Type::VECTOR:
+            writeArray(value.asValueVector());
+            break;
+        case Value::Type::MAP:
+            writeDict(value.asValueMap());
+            break;
+        default:
+            break;
+        }
+    }
+
+    void writeArray(const ValueVector& array)
+    {
+        uint32_t count = 0;
+        for (const auto& value : array)
+            count += isEncodable(value);
+        writeType(TYPE_ARRAY);
+        write(count);
+        for (const auto& value : array)
+            writeValue(value);
+    }
+
+    void writeDict(const ValueMap& dict)
+    {
+        uint32_t count = 0;
+        for (const auto& iter : dict)
+            count += isEncodable(iter.second);
+        writeType(TYPE_DICT);
+        write(count);
+        for (const auto& iter : dict)
+        {
+            if (!isEncodable(iter.second))
+                continue;
+            write(indexOf(iter.first));
+            writeValue(iter.second);
+        }
+    }
+
+private:
+    static bool isEncodable(const Value& value)
+    {
+        switch (value.getType())
+        {
+        case Value::Type::BOOLEAN:
+        case Value::Type::INTEGER:
+        case Value::Type::FLOAT:
+        case Value::Type::DOUBLE:
+        case Value::Type::STRING:
+        case Value::Type::VECTOR:
+        case Value::Type::MAP:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    void addString(const std::string& str)
+    {
+        auto result = _indices.emplace(str, (uint32_t)_strings.size());
+        if (result.second)
+            _strings.push_back(&result.first->first);
+    }
+
+    uint32_t indexOf(const std::string& str) const
+    {
+        return _indices.find(str)->second;
+    }
+
+    void writeType(unsigned char type)
+    {
+        _writer.write(&type, 1);
+    }
+
+    template<typename T>
+    void write(const T& value)
+    {
+        _writer.write(&value, sizeof(T));
+    }
+
+    PlistWriter& _writer;
+    std::unordered_map<std::string, uint32_t> _indices;
+    // in index order, pointing at the keys of _indices
+    std::vector<const std::string*> _strings;
+};
+
+} // namespace
+
+bool CompiledPlist::isCompiledPlist(const unsigned char* bytes, size_t size)
+{
+    return bytes && size >= sizeof(MAGIC) && memcmp(bytes, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+ValueMap CompiledPlist::decodeValueMap(const unsigned char* bytes, size_t size)
+{
+    ValueMap dict;
+    Reader reader(bytes, size);
+    unsigned char type;
+    if (!reader.readHeader() || !reader.readType(type))
+    {
+        CCLOG("CompiledPlist: corrupted header");
+        return dict;
+    }
+    if (type == TYPE_DICT && !reader.readDict(dict, 0))
+    {
+        CCLOG("CompiledPlist: corrupted dictionary");
+        dict.clear();
+    }
+    return dict;
+}
+
+ValueVector CompiledPlist::decodeValueVector(const unsigned char* bytes, size_t size)
+{
+    ValueVector array;
+    Reader reader(bytes, size);
+    unsigned char type;
+    if (!reader.readHeader() || !reader.readType(type))
+    {
+        CCLOG("CompiledPlist: corrupted header");
+        return array;
+    }
+    if (type == TYPE_ARRAY && !reader.readArray(array, 0))
+    {
+        CCLOG("CompiledPlist: corrupted array");
+        array.clear();
+    }
+    return array;
+}
+
+void CompiledPlist::encodeValueMap(const ValueMap& dict, PlistWriter& writer)
+{
+    Encoder encoder(writer);
+    encoder.collectDict(dict);
+    encoder.writeHeader();
+    encoder.writeDict(dict);
+}
+
+void CompiledPlist::encodeValueVector(const ValueVector& array, PlistWriter& writer)
+{
+    Encoder encoder(writer);
+    encoder.collectArray(array);
+    encoder.writeHeader();
+    encoder.writeArray(array);
+}
+
+NS_CC_END
@@ -0,0 +1,101 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+#ifndef __CC_COMPILEDPLIST_H__
+#define __CC_COMPILEDPLIST_H__
+
+#include <cstddef>
+
+#include "platform/CCPlatformMacros.h"
+#include "base/CCValue.h"
+
+NS_CC_BEGIN
+
+class PlistWriter;
+
+/**
+ * @addtogroup platform
+ * @{
+ */
+
+/**
+ *  Decoder of compiled plists, the binary form the publisher converts .plist files to when run
+ *  with --compile-plist. Only this FileUtils variant decodes it : leave the option off for builds
+ *  using CCFileUtils.cpp or FileUtilsApple.
+ *
+ *  Layout, little endian :
+ *      - magic "ccpl", uint32 format version
+ *      - string table : uint32 count, then (uint32 length, bytes) per string
+ *      - root value, a tagged tree : uint8 type then
+ *          - false / true : nothing
+ *          - integer : int32
+ *          - real : double
+ *          - string : uint32 index in the string table
+ *          - array : uint32 count, then the values
+ *          - dict : uint32 count, then (uint32 key index, value) pairs
+ *
+ *  Values decode to what the XML parser would have built, without a DOM nor any text parsing.
+ *  The publisher LZ4-compresses and encrypts the result like any other asset; the runtime can
+ *  also write it, see PlistWriter.
+ */
+class CC_DLL CompiledPlist
+{
+public:
+    /**
+     *  Checks whether a buffer holds a compiled plist rather than XML.
+     */
+    static bool isCompiledPlist(const unsigned char* bytes, size_t size);
+
+    /**
+     *  Decodes a compiled plist whose root is a dictionary.
+     *  @return The dictionary, empty if the buffer is corrupted or its root isn't a dictionary.
+     */
+    static ValueMap decodeValueMap(const unsigned char* bytes, size_t size);
+
+    /**
+     *  Decodes a compiled plist whose root is an array.
+     *  @return The array, empty if the buffer is corrupted or its root isn't an array.
+     */
+    static ValueVector decodeValueVector(const unsigned char* bytes, size_t size);
+
+    /**
+     *  Encodes a dictionary as the root of a compiled plist.
+     *  Values that can't appear in a plist are left out, along with their key.
+     */
+    static void encodeValueMap(const ValueMap& dict, PlistWriter& writer);
+
+    /**
+     *  Encodes an array as the root of a compiled plist.
+     *  Values that can't appear in a plist are left out.
+     */
+    static void encodeValueVector(const ValueVector& array, PlistWriter& writer);
+};
+
+// end of support group
+/** @} */
+
+NS_CC_END
+
+#endif    // __CC_COMPILEDPLIST_H__
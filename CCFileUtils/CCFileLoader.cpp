@@ -0,0 +1,565 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "platform/CCFileLoader.h"
+#include "platform/CCFileUtils.h"
+#include "platform/CCMainThreadQueue.h"
+#include "platform/CCBatchReader.h"
+
+#include "base/ccMacros.h"
+
+#include <algorithm>
+
+NS_CC_BEGIN
+
+// reads are IO bound, a couple of threads keep the storage busy
+static const size_t IO_THREAD_COUNT = 2;
+// loads read together by an IO thread
+static const size_t IO_BATCH_SIZE = 16;
+static const size_t MAX_WORKER_COUNT = 4;
+static const size_t WORKER_QUEUE_CAPACITY = 64;
+
+struct FileLoader::Handle::State
+{
+    State(Priority priority, const std::string& fullPath, bool forString)
+    : cancelled(false)
+    , priority((int)priority)
+    , fullPath(fullPath)
+    , forString(forString)
+    {}
+
+    std::atomic<bool> cancelled;
+    std::atomic<int> priority;
+    std::string fullPath;
+    bool forString;
+};
+
+struct FileLoader::Subscriber
+{
+    std::shared_ptr<Handle::State> state;
+    std::function<void(Data)> dataCallback;
+    std::function<void(std::string)> stringCallback;
+};
+
+// one per file in flight, shared by the subscribers attached to it
+struct FileLoader::Request
+{
+    std::string fullPath;
+    bool forString;
+    std::vector<Subscriber> subscribers;    // guarded by _ioMutex
+    bool queued;                            // in _ioQueues, guarded by _ioMutex
+    std::atomic<int> priority;              // highest priority of the subscribers
+    std::atomic<bool> cancelled;            // every subscriber is cancelled
+    Data data;
+    size_t rawSize;
+};
+
+struct FileLoader::Worker
+{
+    Worker()
+    {
+        for (int i = 0; i < PRIORITY_COUNT; ++i)
+            queues[i].reset(new LockFreeQueue<Request*>(WORKER_QUEUE_CAPACITY));
+    }
+
+    std::unique_ptr<LockFreeQueue<Request*>> queues[PRIORITY_COUNT];
+    std::thread thread;
+};
+
+FileLoader* FileLoader::s_sharedFileLoader = nullptr;
+static std::mutex s_instanceMutex;
+
+void FileLoader::Handle::cancel()
+{
+    if (!_state)
+        return;
+    _state->cancelled = true;
+    std::lock_guard<std::mutex> guard(s_instanceMutex);
+    if (s_sharedFileLoader)
+        s_sharedFileLoader->cancel(_state);
+}
+
+void FileLoader::Handle::setPriority(Priority priority)
+{
+    if (!_state)
+        return;
+    std::lock_guard<std::mutex> guard(s_instanceMutex);
+    if (s_sharedFileLoader)
+        s_sharedFileLoader->reprioritize(_state, priority);
+}
+
+FileLoader* FileLoader::getInstance()
+{
+    std::lock_guard<std::mutex> guard(s_instanceMutex);
+    if (s_sharedFileLoader == nullptr)
+        s_sharedFileLoader = new (std::nothrow) FileLoader();
+    return s_sharedFileLoader;
+}
+
+void FileLoader::destroyInstance()
+{
+    std::lock_guard<std::mutex> guard(s_instanceMutex);
+    CC_SAFE_DELETE(s_sharedFileLoader);
+}
+
+FileLoader::FileLoader()
+: _stop(false)
+, _ioQueued(0)
+, _nextWorker(0)
+, _cpuPending(0)
+, _ioQueuePeak(0)
+, _cpuQueuePeak(0)
+, _filesRead(0)
+, _bytesRead(0)
+, _filesDecoded(0)
+, _steals(0)
+, _inlineDecodes(0)
+, _cancelledQueued(0)
+, _cancelledRead(0)
+, _bytesNotDecoded(0)
+, _coalesced(0)
+{
+    size_t workerCount = std::thread::hardware_concurrency();
+    workerCount = workerCount > 1 ? workerCount - 1 : 1;
+    if (workerCount > MAX_WORKER_COUNT)
+        workerCount = MAX_WORKER_COUNT;
+
+    for (size_t i = 0; i < workerCount; ++i)
+        _workers.push_back(std::unique_ptr<Worker>(new Worker()));
+    for (size_t i = 0; i < workerCount; ++i)
+        _workers[i]->thread = std::thread(&FileLoader::workerLoop, this, i);
+    for (size_t i = 0; i < IO_THREAD_COUNT; ++i)
+        _ioThreads.push_back(std::thread(&FileLoader::ioThreadLoop, this));
+}
+
+FileLoader::~FileLoader()
+{
+    {
+        std::lock_guard<std::mutex> ioGuard(_ioMutex);
+        std::lock_guard<std::mutex> cpuGuard(_cpuMutex);
+        _stop = true;
+    }
+    _ioCondition.notify_all();
+    _cpuCondition.notify_all();
+
+    for (auto& thread : _ioThreads)
+        thread.join();
+    for (auto& worker : _workers)
+        worker->thread.join();
+
+    Request* request = nullptr;
+    for (int priority = 0; priority < PRIORITY_COUNT; ++priority)
+    {
+        for (auto queued : _ioQueues[priority])
+            delete queued;
+        for (auto& worker : _workers)
+            while (worker->queues[priority]->pop(request))
+                delete request;
+    }
+}
+
+FileLoader::Handle FileLoader::loadData(const std::string& fullPath, std::function<void(Data)> callback, Priority priority)
+{
+    Subscriber subscriber;
+    subscriber.dataCallback = std::move(callback);
+    return load(fullPath, false, std::move(subscriber), priority);
+}
+
+FileLoader::Handle FileLoader::loadString(const std::string& fullPath, std::function<void(std::string)> callback, Priority priority)
+{
+    Subscriber subscriber;
+    subscriber.stringCallback = std::move(callback);
+    return load(fullPath, true, std::move(subscriber), priority);
+}
+
+FileLoader::Stats FileLoader::getStats() const
+{
+    Stats stats;
+    {
+        std::lock_guard<std::mutex> guard(_ioMutex);
+        stats.ioQueueDepth = _ioQueued;
+    }
+    stats.ioQueuePeak = _ioQueuePeak;
+    stats.cpuQueueDepth = _cpuPending;
+    stats.cpuQueuePeak = _cpuQueuePeak;
+    stats.filesRead = _filesRead;
+    stats.bytesRead = _bytesRead;
+    stats.filesDecoded = _filesDecoded;
+    stats.steals = _steals;
+    stats.inlineDecodes = _inlineDecodes;
+    stats.cancelledQueued = _cancelledQueued;
+    stats.cancelledRead = _cancelledRead;
+    stats.bytesNotDecoded = _bytesNotDecoded;
+    stats.coalesced = _coalesced;
+    return stats;
+}
+
+void FileLoader::updatePeak(std::atomic<size_t>& peak, size_t value)
+{
+    size_t current = peak.load(std::memory_order_relaxed);
+    while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        ;
+}
+
+FileLoader::Handle FileLoader::load(const std::string& fullPath, bool forString, Subscriber&& subscriber, Priority priority)
+{
+    Handle handle;
+    handle._state = std::make_shared<Handle::State>(priority, fullPath, forString);
+    subscriber.state = handle._state;
+
+    size_t depth = 0;
+    {
+        std::lock_guard<std::mutex> guard(_ioMutex);
+        auto& inflight = _inflight[forString ? 1 : 0];
+        auto it = inflight.find(fullPath);
+        // a cancelled load may already be aborting, it can't be joined
+        if (it != inflight.end() && !it->second->cancelled)
+        {
+            it->second->subscribers.push_back(std::move(subscriber));
+            updatePriority(it->second);
+        }
+        else
+        {
+            Request* request = new Request();
+            request->fullPath = fullPath;
+            request->forString = forString;
+            request->subscribers.push_back(std::move(subscriber));
+            request->queued = true;
+            request->priority = (int)priority;
+            request->cancelled = false;
+            request->rawSize = 0;
+            inflight[fullPath] = request;
+            _ioQueues[(int)priority].push_back(request);
+            depth = ++_ioQueued;
+        }
+    }
+
+    if (depth == 0)
+    {
+        ++_coalesced;
+        return handle;
+    }
+    updatePeak(_ioQueuePeak, depth);
+    _ioCondition.notify_one();
+    return handle;
+}
+
+FileLoader::Request* FileLoader::findInflight(const std::shared_ptr<Handle::State>& state) const
+{
+    auto& inflight = _inflight[state->forString ? 1 : 0];
+    auto it = inflight.find(state->fullPath);
+    if (it == inflight.end())
+        return nullptr;
+    for (auto& subscriber : it->second->subscribers)
+    {
+        if (subscriber.state == state)
+            return it->second;
+    }
+    return nullptr;
+}
+
+void FileLoader::updatePriority(Request* request)
+{
+    int priority = PRIORITY_COUNT - 1;
+    for (auto& subscriber : request->subscribers)
+    {
+        if (!subscriber.state->cancelled && subscriber.state->priority < priority)
+            priority = subscriber.state->priority;
+    }
+    if (priority == request->priority)
+        return;
+
+    if (request->queued)
+    {
+        removeQueued(request);
+        _ioQueues[priority].push_back(request);
+        request->queued = true;
+        ++_ioQueued;
+    }
+    request->priority = priority;
+}
+
+void FileLoader::removeQueued(Request* request)
+{
+    auto& queue = _ioQueues[request->priority];
+    auto it = std::find(queue.begin(), queue.end(), request);
+    if (it != queue.end())
+    {
+        queue.erase(it);
+        request->queued = false;
+        --_ioQueued;
+    }
+}
+
+void FileLoader::removeInflight(Request* request)
+{
+    auto& inflight = _inflight[request->forString ? 1 : 0];
+    auto it = inflight.find(request->fullPath);
+    if (it != inflight.end() && it->second == request)
+        inflight.erase(it);
+}
+
+void FileLoader::cancel(const std::shared_ptr<Handle::State>& state)
+{
+    Request* request = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(_ioMutex);
+        request = findInflight(state);
+        if (request == nullptr)
+            return;
+        for (auto& subscriber : request->subscribers)
+        {
+            if (!subscriber.state->cancelled)
+            {
+                updatePriority(request);
+                return;
+            }
+        }
+
+        request->cancelled = true;
+        if (!request->queued)
+            return;     // already read, the CPU stage drops it
+        removeQueued(request);
+        removeInflight(request);
+    }
+    ++_cancelledQueued;
+    delete request;
+}
+
+void FileLoader::reprioritize(const std::shared_ptr<Handle::State>& state, Priority priority)
+{
+    std::lock_guard<std::mutex> guard(_ioMutex);
+    state->priority = (int)priority;
+    Request* request = findInflight(state);
+    if (request)
+        updatePriority(request);
+}
+
+void FileLoader::ioThreadLoop()
+{
+    auto fileUtils = FileUtils::getInstance();
+    auto batchReader = BatchReader::getInstance();
+    std::vector<Request*> batch;
+    std::vector<BatchReader::Request> reads;
+    for (;;)
+    {
+        batch.clear();
+        {
+            std::unique_lock<std::mutex> lock(_ioMutex);
+            _ioCondition.wait(lock, [this] { return _stop || _ioQueued > 0; });
+            if (_stop)
+                return;
+            // leave some of the queue to the other IO threads
+            size_t batchSize = std::min(IO_BATCH_SIZE, (_ioQueued + IO_THREAD_COUNT - 1) / IO_THREAD_COUNT);
+            for (int priority = 0; priority < PRIORITY_COUNT && batch.size() < batchSize; ++priority)
+            {
+                auto& queue = _ioQueues[priority];
+                while (!queue.empty() && batch.size() < batchSize)
+                {
+                    batch.push_back(queue.front());
+                    queue.pop_front();
+                    batch.back()->queued = false;
+                    --_ioQueued;
+                }
+            }
+        }
+
+        // the reads of a batch are all in flight together, see BatchReader
+        reads.resize(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+#ifdef _WIN32
+            // text must be read in text mode there, left to getxxTeaData()
+            if (batch[i]->forString)
+            {
+                reads[i].path.clear();
+                continue;
+            }
+#endif
+            reads[i].path = fileUtils->getSuitableFOpen(batch[i]->fullPath);
+        }
+        batchReader->read(reads);
+
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            Request* request = batch[i];
+            if (reads[i].buffer)
+                request->data.fastSet(reads[i].buffer, reads[i].size);
+            else
+                fileUtils->getxxTeaData(request->data, request->fullPath, request->forString);
+            request->rawSize = request->data.getSize();
+            ++_filesRead;
+            _bytesRead += request->rawSize;
+            dispatch(request);
+        }
+    }
+}
+
+void FileLoader::dispatch(Request* request)
+{
+    // round robin over the workers' queues, the first one with room takes it
+    int priority = request->priority;
+    size_t count = _workers.size();
+    size_t first = _nextWorker++;
+    for (size_t i = 0; i < count; ++i)
+    {
+        ++_cpuPending;
+        if (_workers[(first + i) % count]->queues[priority]->push(request))
+        {
+            updatePeak(_cpuQueuePeak, _cpuPending);
+            {
+                // a worker checks _cpuPending under this lock before sleeping, so the wakeup can't be missed
+                std::lock_guard<std::mutex> guard(_cpuMutex);
+            }
+            _cpuCondition.notify_one();
+            return;
+        }
+        --_cpuPending;
+    }
+
+    // every queue is full : decoding here throttles the IO stage instead of growing the backlog
+    ++_inlineDecodes;
+    decode(request);
+}
+
+void FileLoader::workerLoop(size_t index)
+{
+    size_t count = _workers.size();
+    for (;;)
+    {
+        // own queue first, then steal, one priority level at a time
+        Request* request = nullptr;
+        bool found = false;
+        for (int priority = 0; !found && priority < PRIORITY_COUNT; ++priority)
+        {
+            found = _workers[index]->queues[priority]->pop(request);
+            for (size_t i = 1; !found && i < count; ++i)
+            {
+                found = _workers[(index + i) % count]->queues[priority]->pop(request);
+                if (found)
+                    ++_steals;
+            }
+        }
+
+        if (found)
+        {
+            --_cpuPending;
+            decode(request);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(_cpuMutex);
+        _cpuCondition.wait(lock, [this] { return _stop || _cpuPending > 0; });
+        if (_stop)
+            return;
+    }
+}
+
+bool FileLoader::dropIfCancelled(Request* request)
+{
+    if (!request->cancelled)
+        return false;
+    {
+        std::lock_guard<std::mutex> guard(_ioMutex);
+        removeInflight(request);
+    }
+    ++_cancelledRead;
+    _bytesNotDecoded += request->rawSize;
+    delete request;
+    return true;
+}
+
+void FileLoader::decode(Request* request)
+{
+    if (dropIfCancelled(request))
+        return;
+    auto fileUtils = FileUtils::getInstance();
+    fileUtils->decryptData(request->data, request->forString);
+    if (dropIfCancelled(request))
+        return;
+    fileUtils->decompressData(request->data, request->forString, &request->cancelled);
+    if (dropIfCancelled(request))
+        return;
+    ++_filesDecoded;
+    finish(request);
+}
+
+void FileLoader::finish(Request* request)
+{
+    // detached from the in-flight map, no subscriber can attach any more
+    std::vector<Subscriber> subscribers;
+    {
+        std::lock_guard<std::mutex> guard(_ioMutex);
+        removeInflight(request);
+        subscribers.swap(request->subscribers);
+    }
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(), [](const Subscriber& subscriber) {
+        return subscriber.state->cancelled.load();
+    }), subscribers.end());
+
+    // Data has value semantics : every subscriber but the last gets a copy of the decoded buffer
+    std::vector<std::function<void()>> callbacks;
+    std::vector<std::shared_ptr<Handle::State>> states;
+    if (request->forString)
+    {
+        std::string content;
+        if (!request->data.isNull())
+            content.assign((const char*)request->data.getBytes());
+        for (size_t i = 0; i < subscribers.size(); ++i)
+        {
+            if (i + 1 < subscribers.size())
+                callbacks.push_back(std::bind(std::move(subscribers[i].stringCallback), content));
+            else
+                callbacks.push_back(std::bind(std::move(subscribers[i].stringCallback), std::move(content)));
+            states.push_back(std::move(subscribers[i].state));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < subscribers.size(); ++i)
+        {
+            if (i + 1 < subscribers.size())
+                callbacks.push_back(std::bind(std::move(subscribers[i].dataCallback), request->data));
+            else
+                callbacks.push_back(std::bind(std::move(subscribers[i].dataCallback), std::move(request->data)));
+            states.push_back(std::move(subscribers[i].state));
+        }
+    }
+    delete request;
+    if (callbacks.empty())
+        return;
+
+    MainThreadQueue::getInstance()->post([states, callbacks]() {
+        for (size_t i = 0; i < callbacks.size(); ++i)
+        {
+            // it may be cancelled while waiting for the cocos thread
+            if (!states[i]->cancelled)
+                callbacks[i]();
+        }
+    });
+}
+
+NS_CC_END
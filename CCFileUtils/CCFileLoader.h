@@ -0,0 +1,312 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+#ifndef __CC_FILELOADER_H__
+#define __CC_FILELOADER_H__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+
+#include "platform/CCPlatformMacros.h"
+#include "base/CCData.h"
+
+NS_CC_BEGIN
+
+/**
+ * @addtogroup platform
+ * @{
+ */
+
+/**
+ *  Bounded multi-producer multi-consumer queue, lock-free (sequence numbered ring).
+ *  push() fails when the queue is full, pop() fails when it is empty.
+ */
+template<typename T>
+class LockFreeQueue
+{
+public:
+    /** @param capacity rounded up to a power of 2 */
+    explicit LockFreeQueue(size_t capacity)
+    : _enqueuePos(0)
+    , _dequeuePos(0)
+    {
+        size_t size = 2;
+        while (size < capacity)
+            size <<= 1;
+        _mask = size - 1;
+        _cells.reset(new Cell[size]);
+        for (size_t i = 0; i < size; ++i)
+            _cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    bool push(const T& value)
+    {
+        size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = _cells[pos & _mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0)
+            {
+                if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    cell.value = value;
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = _enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool pop(T& value)
+    {
+        size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            Cell& cell = _cells[pos & _mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0)
+            {
+                if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    value = cell.value;
+                    cell.sequence.store(pos + _mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = _dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /** Approximate number of queued elements. */
+    size_t size() const
+    {
+        size_t enqueuePos = _enqueuePos.load(std::memory_order_relaxed);
+        size_t dequeuePos = _dequeuePos.load(std::memory_order_relaxed);
+        return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> _cells;
+    size_t _mask;
+    char _pad0[64];
+    std::atomic<size_t> _enqueuePos;
+    char _pad1[64];
+    std::atomic<size_t> _dequeuePos;
+    char _pad2[64];
+};
+
+/**
+ *  Asynchronous file loader used by the async FileUtils::getDataFromFile / getStringFromFile.
+ *
+ *  Loads go through two stages :
+ *      - IO stage : a few threads reading raw file bytes, several files at a time (see BatchReader).
+ *      - CPU stage : a work-stealing pool decrypting (xxtea) and decompressing (LZ4) them.
+ *  Each CPU worker owns lock-free queues fed by the IO threads, and steals from the others when
+ *  its own are empty, so reading a file overlaps with decoding the previous ones.
+ *  Both stages serve higher priorities first. Callbacks are invoked on the cocos thread.
+ *
+ *  Concurrent loads of the same file are coalesced : a load requested while the file is already
+ *  queued, read or decoded attaches to that in-flight load, and all of them get its result.
+ */
+class CC_DLL FileLoader
+{
+public:
+    enum class Priority
+    {
+        Critical = 0,   // needed to draw the current frame, e.g. UI
+        Visible = 1,    // needed soon, e.g. content entering the screen
+        Prefetch = 2,   // speculative, e.g. the next scene
+    };
+
+    /**
+     *  Handle on a pending load, to reprioritize or cancel it.
+     *  A default constructed handle refers to no load.
+     */
+    class CC_DLL Handle
+    {
+    public:
+        /**
+         *  Cancels the load : its callback is never invoked. Once every load attached to the same
+         *  file is cancelled, it is dropped if it is still queued, or aborted at the next LZ4 block
+         *  if it is being decoded.
+         */
+        void cancel();
+
+        /**
+         *  Moves the load to another priority level, if it hasn't been read yet.
+         */
+        void setPriority(Priority priority);
+
+        bool isValid() const { return _state != nullptr; }
+
+    private:
+        friend class FileLoader;
+        struct State;
+        std::shared_ptr<State> _state;
+    };
+
+    /** Queue depth and throughput counters, for profiling. */
+    struct Stats
+    {
+        size_t ioQueueDepth;        // loads waiting to be read
+        size_t ioQueuePeak;
+        size_t cpuQueueDepth;       // files read, waiting to be decoded
+        size_t cpuQueuePeak;
+        size_t filesRead;
+        size_t bytesRead;
+        size_t filesDecoded;
+        size_t steals;              // decodes taken from another worker's queue
+        size_t inlineDecodes;       // decodes run by an IO thread because all CPU queues were full
+        size_t cancelledQueued;     // loads cancelled before being read
+        size_t cancelledRead;       // loads cancelled after being read, before or during decode
+        size_t bytesNotDecoded;     // file bytes of the loads cancelled after being read
+        size_t coalesced;           // loads attached to an in-flight load of the same file
+    };
+
+    /**
+     *  Gets the instance of FileLoader, starting its threads on first use.
+     */
+    static FileLoader* getInstance();
+
+    /**
+     *  Stops the threads and destroys the instance. Pending loads are dropped.
+     */
+    static void destroyInstance();
+
+    /**
+     *  Loads, decrypts and decompresses a file off the cocos thread.
+     *  @param fullPath Full path of the file, as returned by FileUtils::fullPathForFilename().
+     *  @param callback Called on the cocos thread with the content (null Data on failure).
+     *  @param priority Loads of higher priority are read and decoded first.
+     *  @return A handle to reprioritize or cancel the load.
+     */
+    Handle loadData(const std::string& fullPath, std::function<void(Data)> callback, Priority priority = Priority::Visible);
+
+    /**
+     *  Same as loadData(), for text files.
+     */
+    Handle loadString(const std::string& fullPath, std::function<void(std::string)> callback, Priority priority = Priority::Visible);
+
+    /**
+     *  Gets a snapshot of the pipeline counters.
+     */
+    Stats getStats() const;
+
+private:
+    static const int PRIORITY_COUNT = 3;
+
+    struct Subscriber;
+    struct Request;
+    struct Worker;
+
+    FileLoader();
+    ~FileLoader();
+
+    Handle load(const std::string& fullPath, bool forString, Subscriber&& subscriber, Priority priority);
+    void cancel(const std::shared_ptr<Handle::State>& state);
+    void reprioritize(const std::shared_ptr<Handle::State>& state, Priority priority);
+    Request* findInflight(const std::shared_ptr<Handle::State>& state) const;
+    void updatePriority(Request* request);
+    void removeQueued(Request* request);
+    void removeInflight(Request* request);
+    void ioThreadLoop();
+    void workerLoop(size_t index);
+    void dispatch(Request* request);
+    void decode(Request* request);
+    void finish(Request* request);
+    bool dropIfCancelled(Request* request);
+    static void updatePeak(std::atomic<size_t>& peak, size_t value);
+
+    static FileLoader* s_sharedFileLoader;
+
+    std::atomic<bool> _stop;
+
+    // IO stage, one queue per priority
+    mutable std::mutex _ioMutex;
+    std::condition_variable _ioCondition;
+    std::deque<Request*> _ioQueues[PRIORITY_COUNT];
+    size_t _ioQueued;
+    // loads not delivered yet, by path, for data [0] and string [1] loads
+    std::unordered_map<std::string, Request*> _inflight[2];
+    std::vector<std::thread> _ioThreads;
+
+    // CPU stage
+    std::vector<std::unique_ptr<Worker>> _workers;
+    std::atomic<size_t> _nextWorker;
+    std::atomic<size_t> _cpuPending;
+    std::mutex _cpuMutex;
+    std::condition_variable _cpuCondition;
+
+    std::atomic<size_t> _ioQueuePeak;
+    std::atomic<size_t> _cpuQueuePeak;
+    std::atomic<size_t> _filesRead;
+    std::atomic<size_t> _bytesRead;
+    std::atomic<size_t> _filesDecoded;
+    std::atomic<size_t> _steals;
+    std::atomic<size_t> _inlineDecodes;
+    std::atomic<size_t> _cancelledQueued;
+    std::atomic<size_t> _cancelledRead;
+    std::atomic<size_t> _bytesNotDecoded;
+    std::atomic<size_t> _coalesced;
+};
+
+// end of support group
+/** @} */
+
+NS_CC_END
+
+#endif    // __CC_FILELOADER_H__
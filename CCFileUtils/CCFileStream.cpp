@@ -0,0 +1,257 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "platform/CCFileStream.h"
+
+#include "base/ccMacros.h"
+
+#include "../../external/xxtea/xxtea.h"
+#include "../../external/lz4/lz4frame.h"
+
+NS_CC_BEGIN
+
+// compressed input is pulled from the decrypted stream in pieces of this size
+static const size_t LZ4_INPUT_SIZE = 64 * 1024;
+
+FileStream::FileStream()
+: _fp(nullptr)
+, _chunked(false)
+, _error(false)
+, _size(-1)
+, _chunkPos(0)
+, _dctx(nullptr)
+, _frameDone(false)
+, _lz4InPos(0)
+, _lz4InSize(0)
+, _peekPos(0)
+, _peekSize(0)
+, _dataPos(0)
+{
+}
+
+FileStream::~FileStream()
+{
+    if (_fp)
+        fclose(_fp);
+    if (_dctx)
+        LZ4F_freeDecompressionContext(_dctx);
+}
+
+bool FileStream::open(FILE* fp, const char* key, int keyLen, const char* sign, int signLen)
+{
+    _fp = fp;
+
+    // encrypted files start with the sign; chunked ones follow it with mark 19911107,
+    // then [uint32 length, xxtea chunk] pairs, each chunk decrypting independently
+    if (sign && signLen > 0)
+    {
+        std::vector<char> head(signLen + sizeof(unsigned int));
+        size_t headSize = fread(head.data(), 1, head.size(), _fp);
+        if (headSize >= (size_t)signLen && memcmp(head.data(), sign, signLen) == 0)
+        {
+            unsigned int mark = 0;
+            if (headSize == head.size())
+                memcpy(&mark, head.data() + signLen, sizeof(unsigned int));
+            if (mark != 19911107)
+                return false;
+            _chunked = true;
+            _key.assign(key, keyLen);
+        }
+        else
+        {
+            fseek(_fp, 0, SEEK_SET);
+        }
+    }
+
+    // the decrypted content is either plain, or an LZ4 frame behind [mark 19911106, uint32 size]
+    ssize_t peekSize = readDecrypted(_peek, sizeof(_peek));
+    if (peekSize < 0)
+        return false;
+    _peekSize = peekSize;
+    unsigned int mark = 0;
+    if (_peekSize == sizeof(_peek))
+        memcpy(&mark, _peek, sizeof(unsigned int));
+    if (mark == 19911106)
+    {
+        unsigned int size = 0;
+        memcpy(&size, _peek + sizeof(unsigned int), sizeof(unsigned int));
+        _size = size;
+        _peekPos = _peekSize;
+        if (LZ4F_isError(LZ4F_createDecompressionContext(&_dctx, LZ4F_VERSION)))
+            return false;
+        _lz4In.resize(LZ4_INPUT_SIZE);
+    }
+    else if (!_chunked)
+    {
+        long pos = ftell(_fp);
+        fseek(_fp, 0, SEEK_END);
+        _size = ftell(_fp) - pos + _peekSize;
+        fseek(_fp, pos, SEEK_SET);
+    }
+    return true;
+}
+
+void FileStream::setData(Data&& data)
+{
+    _data = std::move(data);
+    _dataPos = 0;
+    _size = _data.getSize();
+}
+
+ssize_t FileStream::read(void* buf, size_t size)
+{
+    if (_error)
+        return -1;
+    unsigned char* out = static_cast<unsigned char*>(buf);
+
+    if (!_fp)
+    {
+        size_t remaining = _data.getSize() - _dataPos;
+        size_t count = std::min(size, remaining);
+        if (count > 0)
+            memcpy(out, _data.getBytes() + _dataPos, count);
+        _dataPos += count;
+        return count;
+    }
+
+    if (_dctx)
+        return readDecompressed(out, size);
+
+    size_t count = 0;
+    if (_peekPos < _peekSize)
+    {
+        count = std::min(size, _peekSize - _peekPos);
+        memcpy(out, _peek + _peekPos, count);
+        _peekPos += count;
+    }
+    if (count < size)
+    {
+        ssize_t ret = readDecrypted(out + count, size - count);
+        if (ret < 0)
+            return count > 0 ? count : -1;
+        count += ret;
+    }
+    return count;
+}
+
+ssize_t FileStream::readDecrypted(unsigned char* buf, size_t size)
+{
+    if (!_chunked)
+    {
+        size_t ret = fread(buf, 1, size, _fp);
+        if (ret < size && ferror(_fp))
+        {
+            _error = true;
+            return -1;
+        }
+        return ret;
+    }
+
+    size_t count = 0;
+    while (count < size)
+    {
+        if (_chunkPos == _chunk.size() && !nextChunk())
+            break;
+        size_t n = std::min(size - count, _chunk.size() - _chunkPos);
+        memcpy(buf + count, _chunk.data() + _chunkPos, n);
+        _chunkPos += n;
+        count += n;
+    }
+    if (_error)
+        return -1;
+    return count;
+}
+
+bool FileStream::nextChunk()
+{
+    unsigned int chunkLen = 0;
+    size_t ret = fread(&chunkLen, 1, sizeof(chunkLen), _fp);
+    if (ret == 0 && feof(_fp))
+        return false;
+    if (ret != sizeof(chunkLen))
+    {
+        _error = true;
+        return false;
+    }
+
+    _cipher.resize(chunkLen);
+    if (chunkLen == 0 || fread(_cipher.data(), 1, chunkLen, _fp) != chunkLen)
+    {
+        CCLOG("FileStream: truncated chunk");
+        _error = true;
+        return false;
+    }
+    xxtea_long decryptedSize = 0;
+    unsigned char* decrypted = xxtea_decrypt(_cipher.data(), chunkLen,
+        (unsigned char*)_key.data(), (xxtea_long)_key.size(), &decryptedSize);
+    if (!decrypted)
+    {
+        CCLOG("FileStream: failed to decrypt chunk");
+        _error = true;
+        return false;
+    }
+    _chunk.assign(decrypted, decrypted + decryptedSize);
+    _chunkPos = 0;
+    free(decrypted);
+    return true;
+}
+
+ssize_t FileStream::readDecompressed(unsigned char* buf, size_t size)
+{
+    size_t count = 0;
+    while (count < size && !_frameDone)
+    {
+        if (_lz4InPos == _lz4InSize)
+        {
+            ssize_t ret = readDecrypted(_lz4In.data(), _lz4In.size());
+            if (ret <= 0)
+            {
+                CCLOG("FileStream: truncated LZ4 frame");
+                _error = true;
+                break;
+            }
+            _lz4InPos = 0;
+            _lz4InSize = ret;
+        }
+        size_t dstSize = size - count;
+        size_t srcSize = _lz4InSize - _lz4InPos;
+        size_t hint = LZ4F_decompress(_dctx, buf + count, &dstSize, _lz4In.data() + _lz4InPos, &srcSize, nullptr);
+        if (LZ4F_isError(hint))
+        {
+            CCLOG("FileStream: %s", LZ4F_getErrorName(hint));
+            _error = true;
+            break;
+        }
+        _lz4InPos += srcSize;
+        count += dstSize;
+        _frameDone = (hint == 0);
+    }
+    if (_error && count == 0)
+        return -1;
+    return count;
+}
+
+NS_CC_END
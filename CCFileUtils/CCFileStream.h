@@ -0,0 +1,131 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+#ifndef __CC_FILESTREAM_H__
+#define __CC_FILESTREAM_H__
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+#include "platform/CCPlatformMacros.h"
+#include "base/CCData.h"
+
+struct LZ4F_dctx_s;
+
+NS_CC_BEGIN
+
+/**
+ * @addtogroup platform
+ * @{
+ */
+
+class FileUtils;
+
+/**
+ *  Sequential reader over a published asset, returned by FileUtils::openStream().
+ *
+ *  Bytes are pulled from the file on demand, decrypted one chunk at a time (chunked xxtea format)
+ *  and run through an incremental LZ4F decoder, so the working set stays at a few hundred KB
+ *  whatever the size of the file.
+ *
+ *  Files encrypted as a whole (the non-chunked xxtea format) cannot be decrypted progressively,
+ *  nor can files FileUtils::openStreamFile() can't open : they are loaded with
+ *  FileUtils::getDataFromFile() and served from memory.
+ *
+ *  A FileStream is not thread safe, but may be used from any single thread.
+ */
+class CC_DLL FileStream
+{
+public:
+    /**
+     *  Closes the file and releases the working buffers.
+     */
+    ~FileStream();
+
+    /**
+     *  Reads up to size bytes of content into buf.
+     *  @return The number of bytes read, 0 at the end of the content, -1 if the file is corrupted.
+     */
+    ssize_t read(void* buf, size_t size);
+
+    /**
+     *  Gets the size of the content, once decrypted and decompressed.
+     *  @return The size in bytes, or -1 if the file doesn't record it.
+     */
+    ssize_t getSize() const { return _size; }
+
+private:
+    friend class FileUtils;
+
+    FileStream();
+    FileStream(const FileStream&) = delete;
+    FileStream& operator=(const FileStream&) = delete;
+
+    /**
+     *  Reads fp (as returned by FileUtils::openStreamFile) progressively. Takes ownership of fp.
+     *  @return false if the file must be loaded as a whole (see setData()).
+     */
+    bool open(FILE* fp, const char* key, int keyLen, const char* sign, int signLen);
+
+    /**
+     *  Serves an already decoded buffer, for files that can't be read progressively.
+     */
+    void setData(Data&& data);
+
+    ssize_t readDecrypted(unsigned char* buf, size_t size);
+    bool nextChunk();
+    ssize_t readDecompressed(unsigned char* buf, size_t size);
+
+    FILE* _fp;
+    bool _chunked;
+    bool _error;
+    ssize_t _size;
+    std::string _key;
+
+    std::vector<unsigned char> _cipher;
+    std::vector<unsigned char> _chunk;
+    size_t _chunkPos;
+
+    struct LZ4F_dctx_s* _dctx;
+    bool _frameDone;
+    std::vector<unsigned char> _lz4In;
+    size_t _lz4InPos;
+    size_t _lz4InSize;
+
+    unsigned char _peek[8];
+    size_t _peekPos;
+    size_t _peekSize;
+
+    Data _data;
+    size_t _dataPos;
+};
+
+// end of support group
+/** @} */
+
+NS_CC_END
+
+#endif    // __CC_FILESTREAM_H__
@@ -709,6 +709,33 @@ bool FileUtils::getxxTeaData(Data& data, const std::string& filename, bool forSt
     }
 }
 
+// chunked format : sign, mark 19911107, then [uint32 length, xxtea chunk] pairs.
+// Chunks are decrypted back to the head of the buffer, a decrypted chunk being smaller than its encrypted form.
+static bool decryptChunks(unsigned char* buffer, size_t& size, size_t offset, const char* key, int keyLen)
+{
+	size_t writePos = 0;
+	while (offset < size)
+	{
+		unsigned int chunkLen = 0;
+		if (size - offset < sizeof(unsigned int))
+			return false;
+		memcpy(&chunkLen, buffer + offset, sizeof(unsigned int));
+		offset += sizeof(unsigned int);
+		if (chunkLen == 0 || chunkLen > size - offset)
+			return false;
+		xxtea_long decrypted_size;
+		unsigned char* decrypted = xxtea_decrypt(buffer + offset, chunkLen, (unsigned char*)key, keyLen, &decrypted_size);
+		if (!decrypted)
+			return false;
+		memcpy(buffer + writePos, decrypted, decrypted_size);
+		free(decrypted);
+		writePos += decrypted_size;
+		offset += chunkLen;
+	}
+	size = writePos;
+	return true;
+}
+
 bool FileUtils::decryptData(Data& data, bool forString)
 {
 	if (data.isNull())
@@ -716,25 +743,37 @@ bool FileUtils::decryptData(Data& data, bool forString)
 
 	unsigned char* buffer = data.getBytes();
 	size_t readSize = data.getSize();
-	unsigned char* decrypted = nullptr;
+	bool decrypted = false;
 	for (auto signAndKey : _xxteaList)
 	{
 		if (strncmp((const char*)buffer, signAndKey.SIGN, signAndKey.SIGNLEN) == 0)
 		{
-			xxtea_long decrypted_size;
-			decrypted = xxtea_decrypt(buffer + signAndKey.SIGNLEN,
-				(xxtea_long)readSize - signAndKey.SIGNLEN,
-				(unsigned char*)signAndKey.KEY,
-				signAndKey.KEYLEN,
-				&decrypted_size);
-			memcpy(buffer, decrypted, decrypted_size);
-			readSize = decrypted_size;
-			if (forString)
+			size_t offset = signAndKey.SIGNLEN;
+			if (readSize >= offset + sizeof(unsigned int) && *((unsigned int*)(buffer + offset)) == 19911107)
+			{
+				decrypted = decryptChunks(buffer, readSize, offset + sizeof(unsigned int), signAndKey.KEY, signAndKey.KEYLEN);
+			}
+			else
+			{
+				xxtea_long decrypted_size;
+				unsigned char* result = xxtea_decrypt(buffer + signAndKey.SIGNLEN,
+					(xxtea_long)readSize - signAndKey.SIGNLEN,
+					(unsigned char*)signAndKey.KEY,
+					signAndKey.KEYLEN,
+					&decrypted_size);
+				if (result)
+				{
+					memcpy(buffer, result, decrypted_size);
+					readSize = decrypted_size;
+					free(result);
+					decrypted = true;
+				}
+			}
+			if (decrypted && forString)
 			{
-				buffer[decrypted_size] = '\0';
+				buffer[readSize] = '\0';
 				readSize++;
 			}
-			free(decrypted);
 			break;
 		}
 	}
@@ -750,44 +789,66 @@ void FileUtils::decompressData(Data& data, bool forString)
 {
 	if (data.isNull())
 		return;
-	size_t inputLen = data.getSize();
-	const char* src = reinterpret_cast<const char*>(data.getBytes());
-	size_t markNum = *((unsigned int*)src);
-	if (markNum == 19911106)
-	{ 
-		size_t dstSize = *((unsigned int*)(src + sizeof(unsigned int)));
-		LZ4F_errorCode_t errorCode;
-		LZ4F_decompressionContext_t ctx = nullptr;
-		errorCode = LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION);
-		if (!LZ4F_isError(errorCode))
+	const size_t headerLen = sizeof(unsigned int) * 2;
+	ssize_t inputLen = data.getSize();
+	const unsigned char* src = data.getBytes();
+	if ((size_t)inputLen < headerLen || *((const unsigned int*)src) != 19911106)
+		return;
+	size_t dstSize = *((const unsigned int*)(src + sizeof(unsigned int)));
+	size_t frameLen = inputLen - headerLen;
+
+	// decode in-place : the frame is moved to the tail of a single buffer and
+	// regenerated from its head, so no second full-size allocation is needed
+	size_t bufferLen = LZ4F_DECOMPRESS_INPLACE_BUFFER_SIZE(dstSize);
+	if (forString)
+		bufferLen += 1;
+	if (frameLen > bufferLen)
+	{
+		CCLOG("decompressData: frame larger than its content, size %d", (int)frameLen);
+		data.clear();
+		return;
+	}
+	unsigned char* buffer = data.takeBuffer(&inputLen);
+	if (bufferLen > (size_t)inputLen)
+	{
+		unsigned char* grown = (unsigned char*)realloc(buffer, bufferLen);
+		if (grown == nullptr)
 		{
-			size_t outLen = dstSize;
-			inputLen -= sizeof(unsigned int);
-			char* out = (char*)malloc(outLen);
-			errorCode = LZ4F_decompress(ctx, out, &outLen, src + sizeof(unsigned int) + sizeof(unsigned int), &inputLen, nullptr);
-			if (!LZ4F_isError(errorCode))
-			{
-				unsigned char* convert_var = reinterpret_cast<unsigned char*>(out);
-				if (forString)
-				{
-					size_t tempOutLen = outLen + 1;
-					char* tempBuffer = (char*)malloc(tempOutLen);
-					memcpy(tempBuffer, (const char*)out, tempOutLen);
-					tempBuffer[outLen] = '\0';
-					data.copy((const unsigned char*)tempBuffer, tempOutLen);
-					free(tempBuffer);
-					tempBuffer = nullptr;
-				}
-				else
-				{
-					data.copy((const unsigned char*)convert_var, outLen);
-				}
-				LZ4F_freeDecompressionContext(ctx);
-			}
-			free(out);
-			out = nullptr;
+			free(buffer);
+			return;
 		}
+		buffer = grown;
+	}
+	unsigned char* frame = buffer + bufferLen - frameLen;
+	memmove(frame, buffer + headerLen, frameLen);
+
+	size_t outLen = dstSize;
+	LZ4F_decompressionContext_t ctx = nullptr;
+	LZ4F_errorCode_t errorCode = LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION);
+	if (!LZ4F_isError(errorCode))
+	{
+		errorCode = LZ4F_decompress(ctx, buffer, &outLen, frame, &frameLen, nullptr);
+		LZ4F_freeDecompressionContext(ctx);
+	}
+	if (LZ4F_isError(errorCode) || errorCode != 0)
+	{
+		CCLOG("decompressData: %s", LZ4F_isError(errorCode) ? LZ4F_getErrorName(errorCode) : "truncated frame");
+		free(buffer);
+		return;
+	}
+
+	size_t resultLen = forString ? outLen + 1 : outLen;
+	if (resultLen == 0)
+	{
+		free(buffer);
+		return;
 	}
+	unsigned char* shrunk = (unsigned char*)realloc(buffer, resultLen);
+	if (shrunk != nullptr)
+		buffer = shrunk;
+	if (forString)
+		buffer[outLen] = '\0';
+	data.fastSet(buffer, resultLen);
 }
 /************************************ added by jing ***************************************/
 
@@ -27,26 +27,35 @@ THE SOFTWARE.
 #include "platform/CCFileUtils.h"
 
 #include <stack>
+#include <map>
+#include <unordered_set>
 
 #include "base/CCData.h"
 #include "base/ccMacros.h"
 #include "base/CCDirector.h"
 #include "platform/CCSAXParser.h"
+#include "platform/CCZipIndex.h"
+#include "platform/CCBatchReader.h"
+#include "platform/CCCompiledPlist.h"
+#include "platform/CCPlistWriter.h"
 //#include "base/ccUtils.h"
 
-#include "tinyxml2/tinyxml2.h"
 #ifdef MINIZIP_FROM_SYSTEM
 #include <minizip/unzip.h>
 #else // from our embedded sources
 #include "unzip.h"
 #endif
 #include <sys/stat.h>
+#if (CC_TARGET_PLATFORM != CC_PLATFORM_WIN32) && (CC_TARGET_PLATFORM != CC_PLATFORM_WINRT)
+#include <unistd.h>
+#endif
 
 #include "../../external/xxtea/xxtea.h"
 #include "../../runtime-src/Classes/mx.h"
 #include "../../external/lz4/lz4frame.h"
 #include "../../external/lz4/lz4.h"
 #include "../../external/lz4/lz4hc.h"
+#include "../../external/lz4/lz4_xxhash.h"
 
 #define DECLARE_GUARD std::lock_guard<std::recursive_mutex> mutexGuard(_mutex)
 
@@ -139,6 +148,18 @@ public:
         return _rootArray;
     }
 
+    ValueVector arrayWithDataOfFile(const char* filedata, int filesize)
+    {
+        _resultType = SAX_RESULT_ARRAY;
+        SAXParser parser;
+
+        CCASSERT(parser.init("UTF-8"), "The file format isn't UTF-8");
+        parser.setDelegator(this);
+
+        parser.parse(filedata, filesize);
+        return _rootArray;
+    }
+
     void startElement(void *ctx, const char *name, const char **atts) override
     {
         const std::string sName(name);
@@ -335,12 +356,17 @@ public:
 ValueMap FileUtils::getValueMapFromFile(const std::string& filename) const
 {
     const std::string fullPath = fullPathForFilename(filename);
-    DictMaker tMaker;
-    return tMaker.dictionaryWithContentsOfFile(fullPath);
+    Data data = getDataFromFile(fullPath);
+    if (data.isNull())
+        return ValueMap();
+    return getValueMapFromData((const char*)data.getBytes(), (int)data.getSize());
 }
 
 ValueMap FileUtils::getValueMapFromData(const char* filedata, int filesize) const
 {
+    // plists compiled by the publisher skip the XML parsing
+    if (CompiledPlist::isCompiledPlist((const unsigned char*)filedata, filesize))
+        return CompiledPlist::decodeValueMap((const unsigned char*)filedata, filesize);
     DictMaker tMaker;
     return tMaker.dictionaryWithDataOfFile(filedata, filesize);
 }
@@ -348,19 +374,18 @@ ValueMap FileUtils::getValueMapFromData(const char* filedata, int filesize) cons
 ValueVector FileUtils::getValueVectorFromFile(const std::string& filename) const
 {
     const std::string fullPath = fullPathForFilename(filename);
+    Data data = getDataFromFile(fullPath);
+    if (data.isNull())
+        return ValueVector();
+    if (CompiledPlist::isCompiledPlist(data.getBytes(), data.getSize()))
+        return CompiledPlist::decodeValueVector(data.getBytes(), data.getSize());
     DictMaker tMaker;
-    return tMaker.arrayWithContentsOfFile(fullPath);
+    return tMaker.arrayWithDataOfFile((const char*)data.getBytes(), (int)data.getSize());
 }
 
 
 /*
- * forward statement
- */
-static tinyxml2::XMLElement* generateElementForArray(const ValueVector& array, tinyxml2::XMLDocument *doc);
-static tinyxml2::XMLElement* generateElementForDict(const ValueMap& dict, tinyxml2::XMLDocument *doc);
-
-/*
- * Use tinyxml2 to write plist files
+ * Stream plist files out with PlistWriter
  */
 bool FileUtils::writeToFile(const ValueMap& dict, const std::string &fullPath) const
 {
@@ -369,168 +394,12 @@ bool FileUtils::writeToFile(const ValueMap& dict, const std::string &fullPath) c
 
 bool FileUtils::writeValueMapToFile(const ValueMap& dict, const std::string& fullPath) const
 {
-    tinyxml2::XMLDocument *doc = new (std::nothrow)tinyxml2::XMLDocument();
-    if (nullptr == doc)
-        return false;
-
-    tinyxml2::XMLDeclaration *declaration = doc->NewDeclaration("xml version=\"1.0\" encoding=\"UTF-8\"");
-    if (nullptr == declaration)
-    {
-        delete doc;
-        return false;
-    }
-
-    doc->LinkEndChild(declaration);
-    tinyxml2::XMLElement *docType = doc->NewElement("!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" \"http://www.apple.com/DTDs/PropertyList-1.0.dtd\"");
-    doc->LinkEndChild(docType);
-
-    tinyxml2::XMLElement *rootEle = doc->NewElement("plist");
-    if (nullptr == rootEle)
-    {
-        delete doc;
-        return false;
-    }
-    rootEle->SetAttribute("version", "1.0");
-    doc->LinkEndChild(rootEle);
-
-    tinyxml2::XMLElement *innerDict = generateElementForDict(dict, doc);
-    if (nullptr == innerDict)
-    {
-        delete doc;
-        return false;
-    }
-    rootEle->LinkEndChild(innerDict);
-
-    bool ret = tinyxml2::XML_SUCCESS == doc->SaveFile(getSuitableFOpen(fullPath).c_str());
-
-    delete doc;
-    return ret;
+    return PlistWriter::writeValueMap(dict, getSuitableFOpen(fullPath));
 }
 
 bool FileUtils::writeValueVectorToFile(const ValueVector& vecData, const std::string& fullPath) const
 {
-    tinyxml2::XMLDocument *doc = new (std::nothrow)tinyxml2::XMLDocument();
-    if (nullptr == doc)
-        return false;
-
-    tinyxml2::XMLDeclaration *declaration = doc->NewDeclaration("xml version=\"1.0\" encoding=\"UTF-8\"");
-    if (nullptr == declaration)
-    {
-        delete doc;
-        return false;
-    }
-
-    doc->LinkEndChild(declaration);
-    tinyxml2::XMLElement *docType = doc->NewElement("!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" \"http://www.apple.com/DTDs/PropertyList-1.0.dtd\"");
-    doc->LinkEndChild(docType);
-
-    tinyxml2::XMLElement *rootEle = doc->NewElement("plist");
-    if (nullptr == rootEle)
-    {
-        delete doc;
-        return false;
-    }
-    rootEle->SetAttribute("version", "1.0");
-    doc->LinkEndChild(rootEle);
-
-    tinyxml2::XMLElement *innerDict = generateElementForArray(vecData, doc);
-    if (nullptr == innerDict)
-    {
-        delete doc;
-        return false;
-    }
-    rootEle->LinkEndChild(innerDict);
-
-    bool ret = tinyxml2::XML_SUCCESS == doc->SaveFile(getSuitableFOpen(fullPath).c_str());
-
-    delete doc;
-    return ret;
-}
-
-/*
- * Generate tinyxml2::XMLElement for Object through a tinyxml2::XMLDocument
- */
-static tinyxml2::XMLElement* generateElementForObject(const Value& value, tinyxml2::XMLDocument *doc)
-{
-    // object is String
-    if (value.getType() == Value::Type::STRING)
-    {
-        tinyxml2::XMLElement* node = doc->NewElement("string");
-        tinyxml2::XMLText* content = doc->NewText(value.asString().c_str());
-        node->LinkEndChild(content);
-        return node;
-    }
-
-    // object is integer
-    if (value.getType() == Value::Type::INTEGER)
-    {
-        tinyxml2::XMLElement* node = doc->NewElement("integer");
-        tinyxml2::XMLText* content = doc->NewText(value.asString().c_str());
-        node->LinkEndChild(content);
-        return node;
-    }
-
-    // object is real
-    if (value.getType() == Value::Type::FLOAT || value.getType() == Value::Type::DOUBLE)
-    {
-        tinyxml2::XMLElement* node = doc->NewElement("real");
-        tinyxml2::XMLText* content = doc->NewText(value.asString().c_str());
-        node->LinkEndChild(content);
-        return node;
-    }
-
-    //object is bool
-    if (value.getType() == Value::Type::BOOLEAN) {
-        tinyxml2::XMLElement* node = doc->NewElement(value.asString().c_str());
-        return node;
-    }
-
-    // object is Array
-    if (value.getType() == Value::Type::VECTOR)
-        return generateElementForArray(value.asValueVector(), doc);
-
-    // object is Dictionary
-    if (value.getType() == Value::Type::MAP)
-        return generateElementForDict(value.asValueMap(), doc);
-
-    CCLOG("This type cannot appear in property list");
-    return nullptr;
-}
-
-/*
- * Generate tinyxml2::XMLElement for Dictionary through a tinyxml2::XMLDocument
- */
-static tinyxml2::XMLElement* generateElementForDict(const ValueMap& dict, tinyxml2::XMLDocument *doc)
-{
-    tinyxml2::XMLElement* rootNode = doc->NewElement("dict");
-
-    for (const auto &iter : dict)
-    {
-        tinyxml2::XMLElement* tmpNode = doc->NewElement("key");
-        rootNode->LinkEndChild(tmpNode);
-        tinyxml2::XMLText* content = doc->NewText(iter.first.c_str());
-        tmpNode->LinkEndChild(content);
-
-        tinyxml2::XMLElement *element = generateElementForObject(iter.second, doc);
-        if (element)
-            rootNode->LinkEndChild(element);
-    }
-    return rootNode;
-}
-
-/*
- * Generate tinyxml2::XMLElement for Array through a tinyxml2::XMLDocument
- */
-static tinyxml2::XMLElement* generateElementForArray(const ValueVector& array, tinyxml2::XMLDocument *pDoc)
-{
-    tinyxml2::XMLElement* rootNode = pDoc->NewElement("array");
-
-    for(const auto &value : array) {
-        tinyxml2::XMLElement *element = generateElementForObject(value, pDoc);
-        if (element)
-            rootNode->LinkEndChild(element);
-    }
-    return rootNode;
+    return PlistWriter::writeValueVector(vecData, getSuitableFOpen(fullPath));
 }
 
 #else
@@ -548,11 +417,19 @@ FileUtils* FileUtils::s_sharedFileUtils = nullptr;
 
 void FileUtils::destroyInstance()
 {
+    // the loader threads use the instance, stop them first
+    FileLoader::destroyInstance();
+    if (s_sharedFileUtils && s_sharedFileUtils->_fullPathCachePersistent)
+        s_sharedFileUtils->saveFullPathCache();
     CC_SAFE_DELETE(s_sharedFileUtils);
+    // nothing reads or posts completions anymore
+    BatchReader::destroyInstance();
+    MainThreadQueue::destroyInstance();
 }
 
 void FileUtils::setDelegate(FileUtils *delegate)
 {
+    FileLoader::destroyInstance();
     if (s_sharedFileUtils)
         delete s_sharedFileUtils;
 
@@ -560,7 +437,10 @@ void FileUtils::setDelegate(FileUtils *delegate)
 }
 
 FileUtils::FileUtils()
-    : _writablePath("")
+    : _fullPathCachePersistent(false)
+    , _fullPathCacheLoadPending(false)
+    , _pathHandleGeneration(1)
+    , _writablePath("")
 {
 }
 
@@ -596,6 +476,9 @@ bool FileUtils::writeDataToFile(const Data& data, const std::string& fullPath) c
     auto fileutils = FileUtils::getInstance();
     do
     {
+        // an archive read through the index stays mapped, unmap it before truncating it
+        ZipIndex::purgeCachedIndex(fileutils->getSuitableFOpen(fullPath));
+
         // Read the file from hardware
         FILE *fp = fopen(fileutils->getSuitableFOpen(fullPath).c_str(), mode);
         CC_BREAK_IF(!fp);
@@ -605,6 +488,7 @@ bool FileUtils::writeDataToFile(const Data& data, const std::string& fullPath) c
 
         fclose(fp);
 
+        invalidatePathHandles();
         return true;
     } while (0);
 
@@ -618,6 +502,34 @@ void FileUtils::writeDataToFile(Data data, const std::string& fullPath, std::fun
     }, std::move(callback), std::move(data));
 }
 
+bool FileUtils::writeDataToFile(const Data& data, const std::string& fullPath, WriteMode mode) const
+{
+    if (mode == WriteMode::COMPRESSED)
+        return writeCompressedFile(data.getBytes(), data.getSize(), fullPath);
+    return writeDataToFile(data, fullPath);
+}
+
+void FileUtils::writeDataToFile(Data data, const std::string& fullPath, WriteMode mode, std::function<void(bool)> callback) const
+{
+    performOperationOffthread([fullPath, mode](const Data& dataIn) -> bool {
+        return FileUtils::getInstance()->writeDataToFile(dataIn, fullPath, mode);
+    }, std::move(callback), std::move(data));
+}
+
+bool FileUtils::writeStringToFile(const std::string& dataStr, const std::string& fullPath, WriteMode mode) const
+{
+    if (mode == WriteMode::COMPRESSED)
+        return writeCompressedFile((const unsigned char*)dataStr.data(), dataStr.size(), fullPath);
+    return writeStringToFile(dataStr, fullPath);
+}
+
+void FileUtils::writeStringToFile(std::string dataStr, const std::string& fullPath, WriteMode mode, std::function<void(bool)> callback) const
+{
+    performOperationOffthread([fullPath, mode](const std::string& dataStrIn) -> bool {
+        return FileUtils::getInstance()->writeStringToFile(dataStrIn, fullPath, mode);
+    }, std::move(callback), std::move(dataStr));
+}
+
 bool FileUtils::init()
 {
     DECLARE_GUARD;
@@ -698,6 +610,33 @@ bool FileUtils::getxxTeaData(Data& data, const std::string& filename, bool forSt
 	}
 }
 
+// chunked format : sign, mark 19911107, then [uint32 length, xxtea chunk] pairs.
+// Chunks are decrypted back to the head of the buffer, a decrypted chunk being smaller than its encrypted form.
+static bool decryptChunks(unsigned char* buffer, size_t& size, size_t offset, const char* key, int keyLen)
+{
+	size_t writePos = 0;
+	while (offset < size)
+	{
+		unsigned int chunkLen = 0;
+		if (size - offset < sizeof(unsigned int))
+			return false;
+		memcpy(&chunkLen, buffer + offset, sizeof(unsigned int));
+		offset += sizeof(unsigned int);
+		if (chunkLen == 0 || chunkLen > size - offset)
+			return false;
+		xxtea_long decrypted_size;
+		unsigned char* decrypted = xxtea_decrypt(buffer + offset, chunkLen, (unsigned char*)key, keyLen, &decrypted_size);
+		if (!decrypted)
+			return false;
+		memcpy(buffer + writePos, decrypted, decrypted_size);
+		free(decrypted);
+		writePos += decrypted_size;
+		offset += chunkLen;
+	}
+	size = writePos;
+	return true;
+}
+
 bool FileUtils::decryptData(Data& data, bool forString) const
 {
 	if (data.isNull())
@@ -705,23 +644,35 @@ bool FileUtils::decryptData(Data& data, bool forString) const
 
 	unsigned char* buffer = data.getBytes();
 	size_t readSize = data.getSize();
-	unsigned char* decrypted = nullptr;
+	bool decrypted = false;
 	if (strncmp((const char*)buffer, xxteaSignAndKey.SIGN, xxteaSignAndKey.SIGNLEN) == 0)
 	{
-		xxtea_long decrypted_size;
-		decrypted = xxtea_decrypt(buffer + xxteaSignAndKey.SIGNLEN,
-			(xxtea_long)readSize - xxteaSignAndKey.SIGNLEN,
-			(unsigned char*)xxteaSignAndKey.KEY,
-			xxteaSignAndKey.KEYLEN,
-			&decrypted_size);
-		memcpy(buffer, decrypted, decrypted_size);
-		readSize = decrypted_size;
-		if (forString)
+		size_t offset = xxteaSignAndKey.SIGNLEN;
+		if (readSize >= offset + sizeof(unsigned int) && *((unsigned int*)(buffer + offset)) == 19911107)
+		{
+			decrypted = decryptChunks(buffer, readSize, offset + sizeof(unsigned int), xxteaSignAndKey.KEY, xxteaSignAndKey.KEYLEN);
+		}
+		else
+		{
+			xxtea_long decrypted_size;
+			unsigned char* result = xxtea_decrypt(buffer + xxteaSignAndKey.SIGNLEN,
+				(xxtea_long)readSize - xxteaSignAndKey.SIGNLEN,
+				(unsigned char*)xxteaSignAndKey.KEY,
+				xxteaSignAndKey.KEYLEN,
+				&decrypted_size);
+			if (result)
+			{
+				memcpy(buffer, result, decrypted_size);
+				readSize = decrypted_size;
+				free(result);
+				decrypted = true;
+			}
+		}
+		if (decrypted && forString)
 		{
-			buffer[decrypted_size] = '\0';
+			buffer[readSize] = '\0';
 			readSize++;
 		}
-		free(decrypted);
 	}
 	if (decrypted)
 	{
@@ -731,48 +682,155 @@ bool FileUtils::decryptData(Data& data, bool forString) const
 	return false;
 }
 
-void FileUtils::decompressData(Data& data, bool forString)
+void FileUtils::decompressData(Data& data, bool forString, const std::atomic<bool>* cancelled) const
 {
 	if (data.isNull())
 		return;
-	size_t inputLen = data.getSize();
-	const char* src = reinterpret_cast<const char*>(data.getBytes());
-	size_t markNum = *((unsigned int*)src);
-	if (markNum == 19911106)
+	const size_t headerLen = sizeof(unsigned int) * 2;
+	ssize_t inputLen = data.getSize();
+	const unsigned char* src = data.getBytes();
+	if ((size_t)inputLen < headerLen || *((const unsigned int*)src) != 19911106)
+		return;
+	size_t dstSize = *((const unsigned int*)(src + sizeof(unsigned int)));
+	size_t frameLen = inputLen - headerLen;
+
+	// decode in-place : the frame is moved to the tail of a single buffer and
+	// regenerated from its head, so no second full-size allocation is needed
+	size_t bufferLen = LZ4F_DECOMPRESS_INPLACE_BUFFER_SIZE(dstSize);
+	if (forString)
+		bufferLen += 1;
+	if (frameLen > bufferLen)
+	{
+		CCLOG("decompressData: frame larger than its content, size %d", (int)frameLen);
+		data.clear();
+		return;
+	}
+	unsigned char* buffer = data.takeBuffer(&inputLen);
+	if (bufferLen > (size_t)inputLen)
 	{
-		size_t dstSize = *((unsigned int*)(src + sizeof(unsigned int)));
-		LZ4F_errorCode_t errorCode;
-		LZ4F_decompressionContext_t ctx = nullptr;
-		errorCode = LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION);
-		if (!LZ4F_isError(errorCode))
+		unsigned char* grown = (unsigned char*)realloc(buffer, bufferLen);
+		if (grown == nullptr)
 		{
-			size_t outLen = dstSize;
-			inputLen -= sizeof(unsigned int);
-			char* out = (char*)malloc(outLen);
-			errorCode = LZ4F_decompress(ctx, out, &outLen, src + sizeof(unsigned int) + sizeof(unsigned int), &inputLen, nullptr);
-			if (!LZ4F_isError(errorCode))
+			free(buffer);
+			return;
+		}
+		buffer = grown;
+	}
+	unsigned char* frame = buffer + bufferLen - frameLen;
+	memmove(frame, buffer + headerLen, frameLen);
+
+	// a cancellable load is decoded in steps, so it can be aborted at block boundaries
+	const size_t step = cancelled ? 256 * 1024 : dstSize;
+	size_t outLen = 0;
+	size_t framePos = 0;
+	LZ4F_decompressionContext_t ctx = nullptr;
+	LZ4F_errorCode_t errorCode = LZ4F_createDecompressionContext(&ctx, LZ4F_VERSION);
+	if (!LZ4F_isError(errorCode))
+	{
+		for (;;)
+		{
+			if (cancelled && cancelled->load(std::memory_order_relaxed))
 			{
-				unsigned char* convert_var = reinterpret_cast<unsigned char*>(out);
-				if (forString)
-				{
-					size_t tempOutLen = outLen + 1;
-					char* tempBuffer = (char*)malloc(tempOutLen);
-					memcpy(tempBuffer, (const char*)out, tempOutLen);
-					tempBuffer[outLen] = '\0';
-					data.copy((const unsigned char*)tempBuffer, tempOutLen);
-					free(tempBuffer);
-					tempBuffer = nullptr;
-				}
-				else
-				{
-					data.copy((const unsigned char*)convert_var, outLen);
-				}
 				LZ4F_freeDecompressionContext(ctx);
+				free(buffer);
+				return;
 			}
-			free(out);
-			out = nullptr;
+			size_t dstLen = std::min(step, dstSize - outLen);
+			size_t srcLen = frameLen - framePos;
+			errorCode = LZ4F_decompress(ctx, buffer + outLen, &dstLen, frame + framePos, &srcLen, nullptr);
+			outLen += dstLen;
+			framePos += srcLen;
+			if (LZ4F_isError(errorCode) || errorCode == 0 || (dstLen == 0 && srcLen == 0))
+				break;
 		}
+		LZ4F_freeDecompressionContext(ctx);
+	}
+	if (LZ4F_isError(errorCode) || errorCode != 0)
+	{
+		CCLOG("decompressData: %s", LZ4F_isError(errorCode) ? LZ4F_getErrorName(errorCode) : "truncated frame");
+		free(buffer);
+		return;
+	}
+
+	size_t resultLen = forString ? outLen + 1 : outLen;
+	if (resultLen == 0)
+	{
+		free(buffer);
+		return;
+	}
+	unsigned char* shrunk = (unsigned char*)realloc(buffer, resultLen);
+	if (shrunk != nullptr)
+		buffer = shrunk;
+	if (forString)
+		buffer[outLen] = '\0';
+	data.fastSet(buffer, resultLen);
+}
+
+bool FileUtils::writeCompressedFile(const unsigned char* bytes, size_t size, const std::string& fullPath) const
+{
+	CCASSERT(!fullPath.empty(), "Invalid parameters.");
+	if (size > UINT32_MAX)
+	{
+		CCLOG("writeCompressedFile: %s is too large to compress", fullPath.c_str());
+		return false;
+	}
+
+	// same layout as published assets : [mark 19911106, uint32 size, LZ4 frame], the frame
+	// closing on a checksum of the content so that a torn file fails to decode
+	LZ4F_preferences_t prefs;
+	memset(&prefs, 0, sizeof(prefs));
+	prefs.frameInfo.blockSizeID = LZ4F_max64KB;
+	prefs.frameInfo.blockMode = LZ4F_blockLinked;
+	prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+	prefs.frameInfo.contentSize = size;
+
+	LZ4F_compressionContext_t ctx = nullptr;
+	if (LZ4F_isError(LZ4F_createCompressionContext(&ctx, LZ4F_VERSION)))
+		return false;
+
+	const std::string tmpPath = fullPath + ".tmp";
+	FILE* fp = fopen(getSuitableFOpen(tmpPath).c_str(), "wb");
+	if (!fp)
+	{
+		LZ4F_freeCompressionContext(ctx);
+		return false;
+	}
+
+	// the content is fed in 64KB pieces, the output buffer only has to hold one of them
+	const size_t inputStep = 64 * 1024;
+	std::vector<unsigned char> out(std::max<size_t>(LZ4F_compressBound(inputStep, &prefs), LZ4F_HEADER_SIZE_MAX));
+	const unsigned int header[2] = { 19911106, (unsigned int)size };
+	bool ok = fwrite(header, sizeof(header), 1, fp) == 1;
+
+	size_t outLen = LZ4F_compressBegin(ctx, out.data(), out.size(), &prefs);
+	ok = ok && !LZ4F_isError(outLen) && fwrite(out.data(), 1, outLen, fp) == outLen;
+	for (size_t pos = 0; ok && pos < size; pos += inputStep)
+	{
+		outLen = LZ4F_compressUpdate(ctx, out.data(), out.size(), bytes + pos, std::min(inputStep, size - pos), nullptr);
+		ok = !LZ4F_isError(outLen) && fwrite(out.data(), 1, outLen, fp) == outLen;
+	}
+	if (ok)
+	{
+		outLen = LZ4F_compressEnd(ctx, out.data(), out.size(), nullptr);
+		ok = !LZ4F_isError(outLen) && fwrite(out.data(), 1, outLen, fp) == outLen;
 	}
+	LZ4F_freeCompressionContext(ctx);
+
+	// on disk before the rename, or a power loss could still leave the new name on a torn file
+	ok = fflush(fp) == 0 && ok;
+#if (CC_TARGET_PLATFORM != CC_PLATFORM_WIN32) && (CC_TARGET_PLATFORM != CC_PLATFORM_WINRT)
+	ok = ok && fsync(fileno(fp)) == 0;
+#endif
+	ok = fclose(fp) == 0 && ok;
+	if (!ok)
+	{
+		CCLOG("writeCompressedFile: failed to write %s", tmpPath.c_str());
+		removeFile(tmpPath);
+		return false;
+	}
+
+	// rename() replaces the previous file atomically (platform FileUtils handle an existing target)
+	return renameFile(tmpPath, fullPath);
 }
 
 void FileUtils::purgeCachedEntries()
@@ -780,6 +838,299 @@ void FileUtils::purgeCachedEntries()
     DECLARE_GUARD;
     _fullPathCache.clear();
     _fullPathCacheDir.clear();
+    ++_pathHandleGeneration;
+    ZipIndex::purgeCache();
+}
+
+// saved full path caches : [header] then [uint32 length, key, uint32 length, full path] per entry,
+// files first, directories next
+struct FullPathCacheHeader
+{
+    uint32_t magic;
+    uint32_t formatVersion;
+    uint64_t key;           // search configuration, see getFullPathCacheKey()
+    uint64_t checksum;      // of the entries
+    uint32_t fileCount;
+    uint32_t dirCount;
+};
+
+static const uint32_t FULL_PATH_CACHE_MAGIC = 0x31435046; // "FPC1"
+static const uint32_t FULL_PATH_CACHE_FORMAT_VERSION = 1;
+
+void FileUtils::purgeCachedEntriesShadowedBy(const std::vector<std::string>& searchPaths)
+{
+    if (searchPaths.empty() || (_fullPathCache.empty() && _fullPathCacheDir.empty()))
+        return;
+    ++_pathHandleGeneration;
+
+    // lookups build their candidates from a search path, a resolution directory and the name,
+    // the listing holds the candidates that now exist in the new search paths
+    std::unordered_set<std::string> listing;
+    for (const auto& searchPath : searchPaths)
+    {
+        std::vector<std::string> files;
+        listFilesRecursively(searchPath, &files);
+        listing.insert(files.begin(), files.end());
+    }
+    auto isShadowed = [&](const std::string& name, bool directory) {
+        // names that the file system would normalize can't be matched against the listing
+        if (name.empty() || name[0] == '/' || name.find("./") != std::string::npos || name.find("//") != std::string::npos)
+            return true;
+        if (listing.empty())
+            return false;
+        // files are split as getPathForFilename() does : searchPath + dirname + resolution + basename
+        std::string namePath, nameFile = name;
+        size_t pos = directory ? std::string::npos : name.find_last_of('/');
+        if (pos != std::string::npos)
+        {
+            namePath = name.substr(0, pos + 1);
+            nameFile = name.substr(pos + 1);
+        }
+        for (const auto& searchPath : searchPaths)
+        {
+            for (const auto& resolution : _searchResolutionsOrderArray)
+            {
+                std::string candidate;
+                if (directory)
+                {
+                    candidate = searchPath + name + resolution;
+                }
+                else
+                {
+                    candidate = searchPath + namePath + resolution;
+                    if (!candidate.empty() && candidate[candidate.length() - 1] != '/')
+                        candidate += '/';
+                    candidate += nameFile;
+                }
+                if (listing.find(candidate) != listing.end())
+                    return true;
+            }
+        }
+        return false;
+    };
+
+    for (auto iter = _fullPathCache.begin(); iter != _fullPathCache.end();)
+    {
+        if (isShadowed(getNewFilename(iter->first), false))
+            iter = _fullPathCache.erase(iter);
+        else
+            ++iter;
+    }
+    for (auto iter = _fullPathCacheDir.begin(); iter != _fullPathCacheDir.end();)
+    {
+        std::string dir = iter->first;
+        if (dir[dir.length() - 1] != '/')
+            dir += "/";
+        if (isShadowed(dir, true))
+            iter = _fullPathCacheDir.erase(iter);
+        else
+            ++iter;
+    }
+}
+
+FileUtils::PathHandle FileUtils::getPathHandle(const std::string& filename) const
+{
+    DECLARE_GUARD;
+    if (filename.empty())
+        return 0;
+    return _pathArena.intern(filename);
+}
+
+FileUtils::PathHandleEntry* FileUtils::resolvePathHandle(PathHandle handle) const
+{
+    if (!_pathArena.isValid(handle))
+        return nullptr;
+    // misses are resolved again, like the string lookups which don't cache them : the file may have been written since
+    if (handle < _pathHandles.size() && _pathHandles[handle].generation == _pathHandleGeneration && _pathHandles[handle].exists)
+        return &_pathHandles[handle];
+
+    const std::string filename(_pathArena.getString(handle), _pathArena.getLength(handle));
+    const std::string fullPath = fullPathForFilename(filename);
+    PathHandleEntry entry;
+    entry.fullPath = fullPath.empty() ? 0 : _pathArena.intern(fullPath);
+    entry.generation = _pathHandleGeneration;
+    entry.exists = isAbsolutePath(filename) ? isFileExistInternal(filename) : !fullPath.empty();
+    entry.sizeKnown = false;
+    entry.size = 0;
+    // interning the full path may have added a handle
+    if (_pathHandles.size() <= _pathArena.getCount())
+        _pathHandles.resize(_pathArena.getCount() + 1, PathHandleEntry());
+    _pathHandles[handle] = entry;
+    return &_pathHandles[handle];
+}
+
+void FileUtils::invalidatePathHandles() const
+{
+    DECLARE_GUARD;
+    // generation 0 is never current
+    for (auto& entry : _pathHandles)
+        entry.generation = 0;
+}
+
+std::string FileUtils::fullPathForHandle(PathHandle handle) const
+{
+    DECLARE_GUARD;
+    auto entry = resolvePathHandle(handle);
+    if (!entry || entry->fullPath == 0)
+        return "";
+    return std::string(_pathArena.getString(entry->fullPath), _pathArena.getLength(entry->fullPath));
+}
+
+Data FileUtils::getDataFromFile(PathHandle handle, bool isStringFile) const
+{
+    std::string fullPath = fullPathForHandle(handle);
+    if (fullPath.empty())
+        return Data();
+    return getDataFromFile(fullPath, isStringFile);
+}
+
+bool FileUtils::isFileExist(PathHandle handle) const
+{
+    DECLARE_GUARD;
+    auto entry = resolvePathHandle(handle);
+    return entry && entry->exists;
+}
+
+long FileUtils::getFileSize(PathHandle handle) const
+{
+    DECLARE_GUARD;
+    auto entry = resolvePathHandle(handle);
+    if (!entry || entry->fullPath == 0)
+        return 0;
+    if (!entry->sizeKnown)
+    {
+        long size = getFileSize(std::string(_pathArena.getString(entry->fullPath), _pathArena.getLength(entry->fullPath)));
+        // getFileSize() may have resolved other handles and moved the entries
+        entry = &_pathHandles[handle];
+        entry->size = size;
+        entry->sizeKnown = true;
+    }
+    return entry->size;
+}
+
+void FileUtils::setFullPathCachePersistent(bool persistent, const std::string& versionStamp)
+{
+    DECLARE_GUARD;
+    _fullPathCachePersistent = persistent;
+    _fullPathCacheVersion = versionStamp;
+    _fullPathCacheLoadPending = persistent;
+}
+
+std::string FileUtils::getFullPathCacheFile() const
+{
+    return getWritablePath() + "fullpath.cache";
+}
+
+uint64_t FileUtils::getFullPathCacheKey() const
+{
+    // everything fullPathForFilename() depends on, each string followed by its '\0'
+    std::string config;
+    config.append(_fullPathCacheVersion.c_str(), _fullPathCacheVersion.size() + 1);
+    for (const auto& path : _searchPathArray)
+        config.append(path.c_str(), path.size() + 1);
+    config += '\1';
+    for (const auto& resolution : _searchResolutionsOrderArray)
+        config.append(resolution.c_str(), resolution.size() + 1);
+    config += '\1';
+    std::map<std::string, std::string> lookup;
+    for (const auto& iter : _filenameLookupDict)
+        lookup[iter.first] = iter.second.asString();
+    for (const auto& iter : lookup)
+    {
+        config.append(iter.first.c_str(), iter.first.size() + 1);
+        config.append(iter.second.c_str(), iter.second.size() + 1);
+    }
+    return LZ4_XXH64(config.data(), config.size(), 0);
+}
+
+bool FileUtils::saveFullPathCache() const
+{
+    DECLARE_GUARD;
+
+    std::string entries;
+    auto appendString = [&entries](const std::string& str) {
+        uint32_t length = (uint32_t)str.size();
+        entries.append((const char*)&length, sizeof(length));
+        entries.append(str);
+    };
+    for (const auto& iter : _fullPathCache)
+    {
+        appendString(iter.first);
+        appendString(iter.second);
+    }
+    for (const auto& iter : _fullPathCacheDir)
+    {
+        appendString(iter.first);
+        appendString(iter.second);
+    }
+
+    FullPathCacheHeader header;
+    header.magic = FULL_PATH_CACHE_MAGIC;
+    header.formatVersion = FULL_PATH_CACHE_FORMAT_VERSION;
+    header.key = getFullPathCacheKey();
+    header.checksum = LZ4_XXH64(entries.data(), entries.size(), 0);
+    header.fileCount = (uint32_t)_fullPathCache.size();
+    header.dirCount = (uint32_t)_fullPathCacheDir.size();
+
+    std::string content((const char*)&header, sizeof(header));
+    content += entries;
+
+    // written aside then renamed, a crash while saving can't leave a torn cache
+    const std::string path = getFullPathCacheFile();
+    const std::string tmpPath = path + ".tmp";
+    if (!writeStringToFile(content, tmpPath))
+        return false;
+    removeFile(path);
+    return renameFile(tmpPath, path);
+}
+
+void FileUtils::loadFullPathCache() const
+{
+    _fullPathCacheLoadPending = false;
+
+    auto file = MappedFile::open(getSuitableFOpen(getFullPathCacheFile()));
+    if (!file || file->getSize() < sizeof(FullPathCacheHeader))
+        return;
+
+    FullPathCacheHeader header;
+    memcpy(&header, file->getBytes(), sizeof(header));
+    const unsigned char* entries = file->getBytes() + sizeof(header);
+    size_t entriesSize = file->getSize() - sizeof(header);
+    if (header.magic != FULL_PATH_CACHE_MAGIC
+        || header.formatVersion != FULL_PATH_CACHE_FORMAT_VERSION
+        || header.key != getFullPathCacheKey())
+        return;
+    if (header.checksum != LZ4_XXH64(entries, entriesSize, 0))
+    {
+        CCLOG("cocos2d: FileUtils: corrupted full path cache, ignored");
+        return;
+    }
+
+    size_t pos = 0;
+    auto readString = [&](std::string& str) {
+        uint32_t length;
+        if (entriesSize - pos < sizeof(length))
+            return false;
+        memcpy(&length, entries + pos, sizeof(length));
+        pos += sizeof(length);
+        if (entriesSize - pos < length)
+            return false;
+        str.assign((const char*)entries + pos, length);
+        pos += length;
+        return true;
+    };
+    std::string key;
+    std::string fullPath;
+    for (uint32_t i = 0; i < header.fileCount + header.dirCount; ++i)
+    {
+        if (!readString(key) || !readString(fullPath))
+            return;
+        // entries resolved since the configuration was set win
+        if (i < header.fileCount)
+            _fullPathCache.emplace(key, fullPath);
+        else
+            _fullPathCacheDir.emplace(key, fullPath);
+    }
 }
 
 std::string FileUtils::getStringFromFile(const std::string& filename) const
@@ -799,9 +1150,13 @@ void FileUtils::getStringFromFile(const std::string &path, std::function<void (s
     // Get the full path on the main thread, to avoid the issue that FileUtil's is not
     // thread safe, and accessing the fullPath cache and searching the search paths is not thread safe
     auto fullPath = fullPathForFilename(path);
-    performOperationOffthread([fullPath]() -> std::string {
-        return FileUtils::getInstance()->getStringFromFile(fullPath);
-    }, std::move(callback));
+    FileLoader::getInstance()->loadString(fullPath, std::move(callback));
+}
+
+FileLoader::Handle FileUtils::getStringFromFile(const std::string& path, FileLoader::Priority priority, std::function<void(std::string)> callback) const
+{
+    auto fullPath = fullPathForFilename(path);
+    return FileLoader::getInstance()->loadString(fullPath, std::move(callback), priority);
 }
 
 Data FileUtils::getDataFromFile(const std::string& filename, bool isStringFile) const
@@ -816,9 +1171,66 @@ Data FileUtils::getDataFromFile(const std::string& filename, bool isStringFile)
 void FileUtils::getDataFromFile(const std::string& filename, std::function<void(Data)> callback) const
 {
     auto fullPath = fullPathForFilename(filename);
-    performOperationOffthread([fullPath]() -> Data {
-        return FileUtils::getInstance()->getDataFromFile(fullPath);
-    }, std::move(callback));
+    FileLoader::getInstance()->loadData(fullPath, std::move(callback));
+}
+
+FileLoader::Handle FileUtils::getDataFromFile(const std::string& filename, FileLoader::Priority priority, std::function<void(Data)> callback) const
+{
+    auto fullPath = fullPathForFilename(filename);
+    return FileLoader::getInstance()->loadData(fullPath, std::move(callback), priority);
+}
+
+std::unique_ptr<FileStream> FileUtils::openStream(const std::string& filename) const
+{
+    std::string fullPath = fullPathForFilename(filename);
+    if (fullPath.empty())
+        return nullptr;
+
+    std::unique_ptr<FileStream> stream(new (std::nothrow) FileStream());
+    if (!stream)
+        return nullptr;
+    FILE* fp = openStreamFile(fullPath);
+    if (fp && stream->open(fp, xxteaSignAndKey.KEY, xxteaSignAndKey.KEYLEN, xxteaSignAndKey.SIGN, xxteaSignAndKey.SIGNLEN))
+        return stream;
+
+    // encrypted as a whole, or out of fopen's reach : it can only be decoded in memory
+    CCLOG("openStream: %s is loaded whole in memory (%s)", fullPath.c_str(), fp ? "can't be read progressively" : "can't be opened as a file");
+    Data data = getDataFromFile(fullPath);
+    if (data.isNull())
+        return nullptr;
+    stream.reset(new (std::nothrow) FileStream());
+    if (stream)
+        stream->setData(std::move(data));
+    return stream;
+}
+
+FILE* FileUtils::openStreamFile(const std::string& fullPath) const
+{
+    return fopen(getSuitableFOpen(fullPath).c_str(), "rb");
+}
+
+MappedData FileUtils::getMappedData(const std::string& filename) const
+{
+    std::string fullPath = fullPathForFilename(filename);
+    if (fullPath.empty())
+        return MappedData();
+
+    auto file = MappedFile::open(getSuitableFOpen(fullPath));
+    if (file)
+    {
+        const unsigned char* bytes = file->getBytes();
+        size_t size = file->getSize();
+        bool encrypted = size >= (size_t)xxteaSignAndKey.SIGNLEN && memcmp(bytes, xxteaSignAndKey.SIGN, xxteaSignAndKey.SIGNLEN) == 0;
+        bool compressed = size >= sizeof(unsigned int) && *((const unsigned int*)bytes) == 19911106;
+        if (!encrypted && !compressed)
+            return MappedData(file, bytes, size, true);
+    }
+
+    // encrypted, compressed, or not mappable (e.g. inside the apk) : decoded to the heap
+    auto data = std::make_shared<Data>(getDataFromFile(fullPath));
+    if (data->isNull())
+        return MappedData();
+    return MappedData(data, data->getBytes(), data->getSize(), false);
 }
 
 FileUtils::Status FileUtils::getContents(const std::string& filename, ResizableBuffer* buffer) const
@@ -881,6 +1293,14 @@ unsigned char* FileUtils::getFileDataFromZip(const std::string& zipFilePath, con
     unzFile file = nullptr;
     *size = 0;
 
+    // indexed archives are mapped once, a lookup no longer reopens them and scans their central directory
+    if (!zipFilePath.empty())
+    {
+        auto index = ZipIndex::getIndex(getSuitableFOpen(zipFilePath));
+        if (index && index->contains(filename))
+            return index->getFileData(filename, size);
+    }
+
     do
     {
         CC_BREAK_IF(zipFilePath.empty());
@@ -997,6 +1417,13 @@ std::string FileUtils::fullPathForFilename(const std::string &filename) const
     {
         return cacheIter->second;
     }
+    if (_fullPathCacheLoadPending)
+    {
+        loadFullPathCache();
+        cacheIter = _fullPathCache.find(filename);
+        if (cacheIter != _fullPathCache.end())
+            return cacheIter->second;
+    }
 
     // Get the new file name.
     const std::string newFilename( getNewFilename(filename) );
@@ -1048,6 +1475,13 @@ std::string FileUtils::fullPathForDirectory(const std::string &dir) const
     {
         return cacheIter->second;
     }
+    if (_fullPathCacheLoadPending)
+    {
+        loadFullPathCache();
+        cacheIter = _fullPathCacheDir.find(dir);
+        if (cacheIter != _fullPathCacheDir.end())
+            return cacheIter->second;
+    }
     std::string longdir = dir;
     std::string fullpath;
 
@@ -1099,6 +1533,8 @@ void FileUtils::setSearchResolutionsOrder(const std::vector<std::string>& search
 
     _fullPathCache.clear();
     _fullPathCacheDir.clear();
+    ++_pathHandleGeneration;
+    _fullPathCacheLoadPending = _fullPathCachePersistent;
     _searchResolutionsOrderArray.clear();
     for(const auto& iter : searchResolutionsOrder)
     {
@@ -1175,6 +1611,7 @@ void FileUtils::setDefaultResourceRootPath(const std::string& path)
     {
         _fullPathCache.clear();
         _fullPathCacheDir.clear();
+        ++_pathHandleGeneration;
         _defaultResRootPath = path;
         if (!_defaultResRootPath.empty() && _defaultResRootPath[_defaultResRootPath.length()-1] != '/')
         {
@@ -1192,9 +1629,9 @@ void FileUtils::setSearchPaths(const std::vector<std::string>& searchPaths)
     bool existDefaultRootPath = false;
     _originalSearchPaths = searchPaths;
 
-    _fullPathCache.clear();
-    _fullPathCacheDir.clear();
-    _searchPathArray.clear();
+    std::vector<std::string> previousSearchPaths;
+    previousSearchPaths.swap(_searchPathArray);
+    _fullPathCacheLoadPending = _fullPathCachePersistent;
 
     for (const auto& path : _originalSearchPaths)
     {
@@ -1222,6 +1659,28 @@ void FileUtils::setSearchPaths(const std::vector<std::string>& searchPaths)
         //CCLOG("Default root path doesn't exist, adding it.");
         _searchPathArray.push_back(_defaultResRootPath);
     }
+
+    // when paths were only inserted, the cached entries stay valid unless an inserted path shadows them
+    std::vector<std::string> insertedPaths;
+    size_t previous = 0;
+    for (const auto& path : _searchPathArray)
+    {
+        if (previous < previousSearchPaths.size() && path == previousSearchPaths[previous])
+            ++previous;
+        else if (previous < previousSearchPaths.size())
+            insertedPaths.push_back(path);
+        // paths after the last previous one have a lower priority than every cached entry
+    }
+    if (previous == previousSearchPaths.size())
+    {
+        purgeCachedEntriesShadowedBy(insertedPaths);
+    }
+    else
+    {
+        _fullPathCache.clear();
+        _fullPathCacheDir.clear();
+        ++_pathHandleGeneration;
+    }
 }
 
 void FileUtils::addSearchPath(const std::string &searchpath,const bool front)
@@ -1240,17 +1699,32 @@ void FileUtils::addSearchPath(const std::string &searchpath,const bool front)
     if (front) {
         _originalSearchPaths.insert(_originalSearchPaths.begin(), searchpath);
         _searchPathArray.insert(_searchPathArray.begin(), path);
+        // a path added at the back can't shadow a cached entry, one added at the front can
+        purgeCachedEntriesShadowedBy(std::vector<std::string>(1, path));
     } else {
         _originalSearchPaths.push_back(searchpath);
         _searchPathArray.push_back(path);
     }
+    _fullPathCacheLoadPending = _fullPathCachePersistent;
 }
 
 void FileUtils::setFilenameLookupDictionary(const ValueMap& filenameLookupDict)
 {
     DECLARE_GUARD;
-    _fullPathCache.clear();
-    _fullPathCacheDir.clear();
+    // only the files whose lookup changed may resolve differently, directories don't use the lookup
+    for (const auto& iter : _filenameLookupDict)
+    {
+        auto newIter = filenameLookupDict.find(iter.first);
+        if (newIter == filenameLookupDict.end() || !(newIter->second == iter.second))
+            _fullPathCache.erase(iter.first);
+    }
+    for (const auto& iter : filenameLookupDict)
+    {
+        if (_filenameLookupDict.find(iter.first) == _filenameLookupDict.end())
+            _fullPathCache.erase(iter.first);
+    }
+    ++_pathHandleGeneration;
+    _fullPathCacheLoadPending = _fullPathCachePersistent;
     _filenameLookupDict = filenameLookupDict;
 }
 
@@ -1612,9 +2086,11 @@ bool FileUtils::removeDirectory(const std::string& path) const
 
 bool FileUtils::removeFile(const std::string &path) const
 {
+    ZipIndex::purgeCachedIndex(getSuitableFOpen(path));
     if (remove(path.c_str())) {
         return false;
     } else {
+        invalidatePathHandles();
         return true;
     }
 }
@@ -1624,6 +2100,8 @@ bool FileUtils::renameFile(const std::string &oldfullpath, const std::string &ne
     CCASSERT(!oldfullpath.empty(), "Invalid path");
     CCASSERT(!newfullpath.empty(), "Invalid path");
 
+    ZipIndex::purgeCachedIndex(getSuitableFOpen(oldfullpath));
+    ZipIndex::purgeCachedIndex(getSuitableFOpen(newfullpath));
     int errorCode = rename(oldfullpath.c_str(), newfullpath.c_str());
 
     if (0 != errorCode)
@@ -1631,6 +2109,7 @@ bool FileUtils::renameFile(const std::string &oldfullpath, const std::string &ne
         CCLOGERROR("Fail to rename file %s to %s !Error code is %d", oldfullpath.c_str(), newfullpath.c_str(), errorCode);
         return false;
     }
+    invalidatePathHandles();
     return true;
 }
 
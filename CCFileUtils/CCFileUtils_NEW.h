@@ -31,6 +31,8 @@ THE SOFTWARE.
 #include <unordered_map>
 #include <type_traits>
 #include <mutex>
+#include <memory>
+#include <atomic>
 
 #include "platform/CCPlatformMacros.h"
 #include "base/ccTypes.h"
@@ -39,6 +41,11 @@ THE SOFTWARE.
 #include "base/CCAsyncTaskPool.h"
 #include "base/CCScheduler.h"
 #include "base/CCDirector.h"
+#include "platform/CCFileStream.h"
+#include "platform/CCMappedFile.h"
+#include "platform/CCFileLoader.h"
+#include "platform/CCMainThreadQueue.h"
+#include "platform/CCPathArena.h"
 
 NS_CC_BEGIN
 
@@ -179,6 +186,17 @@ public:
      */
     virtual void getStringFromFile(const std::string& path, std::function<void(std::string)> callback) const;
 
+    /**
+     * Gets string from a file, async off the main cocos thread, with a priority.
+     *
+     * @param path filepath for the string to be read. Can be relative or absolute path
+     * @param priority Loads of higher priority are read and decoded first
+     * @param callback Function that will be called when file is read. Will be called
+     * on the main cocos thread, unless the load is cancelled.
+     * @return A handle to reprioritize or cancel the load.
+     */
+    FileLoader::Handle getStringFromFile(const std::string& path, FileLoader::Priority priority, std::function<void(std::string)> callback) const;
+
     /**
      *  Creates binary data from a file.
      *  @return A data object.
@@ -195,6 +213,44 @@ public:
      */
     virtual void getDataFromFile(const std::string& filename, std::function<void(Data)> callback) const;
 
+    /**
+     * Gets a binary data object from a file, async off the main cocos thread, with a priority.
+     *
+     * @param filename filepath for the data to be read. Can be relative or absolute path
+     * @param priority Loads of higher priority are read and decoded first
+     * @param callback Function that will be called when file is read. Will be called
+     * on the main cocos thread, unless the load is cancelled.
+     * @return A handle to reprioritize or cancel the load.
+     */
+    FileLoader::Handle getDataFromFile(const std::string& filename, FileLoader::Priority priority, std::function<void(Data)> callback) const;
+
+    /**
+     *  Opens a file for progressive reading, decrypting and decompressing it on demand.
+     *  Use it instead of getDataFromFile for large files that can be parsed sequentially.
+     *
+     *  The memory used is bounded for plain, compressed and chunk-encrypted files. It is not, and the
+     *  whole decoded file is loaded with getDataFromFile() (which is logged), when :
+     *  - the file is encrypted as a whole (published below the chunked encryption threshold),
+     *  - the file can't be opened with fopen(), like APK assets on Android, unless the platform
+     *    overrides openStreamFile().
+     *
+     *  @param filename The file name, can be relative or absolute path.
+     *  @return A stream positioned at the beginning of the content, or nullptr if the file can't be opened.
+     */
+    virtual std::unique_ptr<FileStream> openStream(const std::string& filename) const;
+
+    /**
+     *  Gets the content of a file without copying it when possible.
+     *  Plain files (neither encrypted nor compressed) are memory mapped and paged in lazily by the system,
+     *  others are decoded as getDataFromFile() does.
+     *  A mapped file must not be rewritten in place while the content is referenced : replace it with
+     *  a new file instead (see MappedFile).
+     *
+     *  @param filename The file name, can be relative or absolute path.
+     *  @return The content, null if the file can't be read.
+     */
+    virtual MappedData getMappedData(const std::string& filename) const;
+
     enum class Status
     {
         OK = 0,
@@ -526,6 +582,13 @@ public:
     */
     virtual bool writeToFile(const ValueMap& dict, const std::string& fullPath) const;
 
+    /** How writeDataToFile() and writeStringToFile() store the content. */
+    enum class WriteMode
+    {
+        PLAIN = 0,      // the bytes as given
+        COMPRESSED = 1, // an LZ4 frame with a content checksum, written aside then renamed
+    };
+
     /**
      *  write a string into a file
      *
@@ -577,6 +640,36 @@ public:
     */
     virtual void writeDataToFile(Data data, const std::string& fullPath, std::function<void(bool)> callback) const;
 
+    /**
+    * write Data into a file, LZ4-compressed when mode is WriteMode::COMPRESSED.
+    *
+    * A compressed file is written next to fullPath then renamed over it, so a crash while saving
+    * leaves the previous file intact. getDataFromFile() decodes it transparently, and returns
+    * null Data if the file was torn or corrupted (the content checksum doesn't match).
+    *
+    *@param data the data want to save
+    *@param fullPath The full path to the file you want to save a string
+    *@param mode How the content is stored
+    *@return bool
+    */
+    virtual bool writeDataToFile(const Data& data, const std::string& fullPath, WriteMode mode) const;
+
+    /**
+    * Same as writeDataToFile(data, fullPath, mode), done async off the main cocos thread.
+    */
+    virtual void writeDataToFile(Data data, const std::string& fullPath, WriteMode mode, std::function<void(bool)> callback) const;
+
+    /**
+    * write a string into a file, LZ4-compressed when mode is WriteMode::COMPRESSED.
+    * See writeDataToFile(data, fullPath, mode); getStringFromFile() decodes it transparently.
+    */
+    virtual bool writeStringToFile(const std::string& dataStr, const std::string& fullPath, WriteMode mode) const;
+
+    /**
+    * Same as writeStringToFile(dataStr, fullPath, mode), done async off the main cocos thread.
+    */
+    virtual void writeStringToFile(std::string dataStr, const std::string& fullPath, WriteMode mode, std::function<void(bool)> callback) const;
+
     /**
     * write ValueMap into a plist file
     *
@@ -847,6 +940,60 @@ public:
     /** Returns the full path cache. */
     const std::unordered_map<std::string, std::string> getFullPathCache() const { return _fullPathCache; }
 
+    /**
+     *  Keeps the full path caches across launches : they are saved to the writable path by
+     *  destroyInstance() or saveFullPathCache(), and loaded back at the first lookup missing the cache.
+     *
+     *  A saved cache is only loaded by the same search paths, resolutions order, filename lookup
+     *  dictionary and version stamp it was saved with.
+     *
+     *  @param persistent Whether to save and load the caches.
+     *  @param versionStamp Identifies the installed content, e.g. the hot update version. Change it
+     *         whenever files are added or removed under the search paths.
+     */
+    void setFullPathCachePersistent(bool persistent, const std::string& versionStamp = "");
+
+    /**
+     *  Saves the full path caches to the writable path now, e.g. when the app enters background.
+     *  @return true if the caches were written.
+     */
+    virtual bool saveFullPathCache() const;
+
+    /** Compact handle on a file name, returned by getPathHandle(). 0 refers to no file. */
+    typedef uint32_t PathHandle;
+
+    /**
+     *  Interns a file name, relative or absolute, for the handle overloads below.
+     *
+     *  Those reuse the full path resolved for the handle instead of building, hashing and copying
+     *  strings on each call. A handle stays valid as long as the FileUtils instance. What is resolved
+     *  for it is cached until the search configuration changes or purgeCachedEntries() is called.
+     *
+     *  @return The handle, the same for the same name.
+     */
+    PathHandle getPathHandle(const std::string& filename) const;
+
+    /**
+     *  Gets the full path of the file a handle refers to, as fullPathForFilename() does.
+     */
+    std::string fullPathForHandle(PathHandle handle) const;
+
+    /**
+     *  Same as getDataFromFile(const std::string&, bool), with a handle from getPathHandle().
+     */
+    Data getDataFromFile(PathHandle handle, bool isStringFile = false) const;
+
+    /**
+     *  Same as isFileExist(const std::string&), with a handle from getPathHandle().
+     */
+    bool isFileExist(PathHandle handle) const;
+
+    /**
+     *  Same as getFileSize(const std::string&), with a handle from getPathHandle().
+     *  The size is cached with the rest of the resolution, until a file is written, removed or renamed through FileUtils.
+     */
+    long getFileSize(PathHandle handle) const;
+
     /**
      *  Gets the new filename from the filename lookup dictionary.
      *  It is possible to have a override names.
@@ -968,6 +1115,35 @@ protected:
      */
     mutable std::unordered_map<std::string, std::string> _fullPathCacheDir;
 
+    /**
+     *  Whether the full path caches are kept across launches, and the version stamp they are saved with.
+     */
+    bool _fullPathCachePersistent;
+    std::string _fullPathCacheVersion;
+
+    /**
+     *  Set when the search configuration changes : the saved caches are looked up at the next cache miss.
+     */
+    mutable bool _fullPathCacheLoadPending;
+
+    /**
+     *  Interned file names and full paths of the path handles.
+     *  Entries are indexed by handle, and resolved again when their generation is outdated :
+     *  _pathHandleGeneration is incremented whenever the full path caches lose entries,
+     *  and invalidatePathHandles() outdates them all when files change. Misses are never reused.
+     */
+    struct PathHandleEntry
+    {
+        PathArena::Handle fullPath;
+        uint32_t generation;
+        bool exists;
+        bool sizeKnown;
+        long size;
+    };
+    mutable PathArena _pathArena;
+    mutable std::vector<PathHandleEntry> _pathHandles;
+    uint32_t _pathHandleGeneration;
+
     /**
      * Writable path.
      */
@@ -993,14 +1169,14 @@ protected:
 #if defined(_MSC_VER) && _MSC_VER  < 1900 
         auto lambda = [action, callback, args...]() 
         {
-            Director::getInstance()->getScheduler()->performFunctionInCocosThread(std::bind(callback, action(args...)));
+            MainThreadQueue::getInstance()->post(std::bind(callback, action(args...)));
         };
 #else
         // As cocos2d-x uses c++11, we will use std::bind to leverage move sematics to
         // move our arguments into our lambda, to potentially avoid copying. 
         auto lambda = std::bind([](const T& actionIn, const R& callbackIn, const ARGS& ...argsIn)
         {
-            Director::getInstance()->getScheduler()->performFunctionInCocosThread(std::bind(callbackIn, actionIn(argsIn...)));
+            MainThreadQueue::getInstance()->post(std::bind(callbackIn, actionIn(argsIn...)));
         }, std::forward<T>(action), std::forward<R>(callback), std::forward<ARGS>(args)...);
         
 #endif
@@ -1010,10 +1186,26 @@ protected:
 
 	/************************************ added by jing ***************************************/
 private:
+	friend class FileLoader;
 	virtual bool getxxTeaData(Data& data, const std::string& filename, bool forString) const;
+	/**
+	 *  Opens a file for openStream(), "rb" and seekable. fopen() by default. Platforms whose files
+	 *  fopen() can't reach, like the APK assets getxxTeaData serves on Android, override it
+	 *  (e.g. funopen() over an AAsset) to keep their streams bounded.
+	 *  @return The file, owned by the caller, or nullptr.
+	 */
+	virtual FILE* openStreamFile(const std::string& fullPath) const;
 	void setXXTEAKeyAndSign(const char *key, int keyLen, const char *sign, int signLen);
 	bool decryptData(Data& data, bool forString) const;
-	void decompressData(Data& data, bool forString) const;
+	void decompressData(Data& data, bool forString, const std::atomic<bool>* cancelled = nullptr) const;
+	bool writeCompressedFile(const unsigned char* bytes, size_t size, const std::string& fullPath) const;
+	std::string getFullPathCacheFile() const;
+	uint64_t getFullPathCacheKey() const;
+	void loadFullPathCache() const;
+	void purgeCachedEntriesShadowedBy(const std::vector<std::string>& searchPaths);
+	PathHandleEntry* resolvePathHandle(PathHandle handle) const;
+	/** Resolves every path handle again, after a file was written, removed or renamed. Platform overrides of those call it too. */
+	void invalidatePathHandles() const;
 	struct SignAndKey
 	{
 		char* KEY;
@@ -0,0 +1,193 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "platform/CCMainThreadQueue.h"
+
+#include <chrono>
+#include <mutex>
+
+#include "base/ccMacros.h"
+#include "base/CCDirector.h"
+#include "base/CCEventDispatcher.h"
+#include "base/CCEventListenerCustom.h"
+
+NS_CC_BEGIN
+
+static const char* SCHEDULE_KEY = "MainThreadQueue";
+
+std::atomic<MainThreadQueue*> MainThreadQueue::s_sharedMainThreadQueue(nullptr);
+static std::mutex s_instanceMutex;
+
+MainThreadQueue* MainThreadQueue::getInstance()
+{
+    // posted from worker threads : the creation must be thread safe, the common path lock free
+    MainThreadQueue* instance = s_sharedMainThreadQueue.load(std::memory_order_acquire);
+    if (instance == nullptr)
+    {
+        std::lock_guard<std::mutex> guard(s_instanceMutex);
+        instance = s_sharedMainThreadQueue.load(std::memory_order_relaxed);
+        if (instance == nullptr)
+        {
+            instance = new (std::nothrow) MainThreadQueue();
+            s_sharedMainThreadQueue.store(instance, std::memory_order_release);
+        }
+    }
+    return instance;
+}
+
+void MainThreadQueue::destroyInstance()
+{
+    std::lock_guard<std::mutex> guard(s_instanceMutex);
+    delete s_sharedMainThreadQueue.exchange(nullptr);
+}
+
+MainThreadQueue::MainThreadQueue()
+: _pending(0)
+, _armed(false)
+, _timeBudget(0.002f)
+, _resetListener(nullptr)
+, _lastFrameCount(0)
+, _maxFrameCount(0)
+, _lastDrainTime(0)
+, _maxDrainTime(0)
+, _carriedOverFrames(0)
+{
+    Node* stub = new Node();
+    stub->next = nullptr;
+    _head = stub;
+    _tail = stub;
+}
+
+MainThreadQueue::~MainThreadQueue()
+{
+    auto director = Director::getInstance();
+    director->getScheduler()->unschedule(SCHEDULE_KEY, this);
+    if (_resetListener)
+        director->getEventDispatcher()->removeEventListener(_resetListener);
+
+    std::function<void()> function;
+    while (pop(function))
+        ;
+    delete _tail;
+}
+
+void MainThreadQueue::post(std::function<void()> function)
+{
+    Node* node = new Node();
+    node->next.store(nullptr, std::memory_order_relaxed);
+    node->function = std::move(function);
+    // counted before it is published : once linked, the drain may pop it and decrement right away
+    ++_pending;
+    Node* prev = _head.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+
+    // the scheduler isn't thread safe, the per frame drain is registered from the cocos thread
+    if (!_armed.exchange(true))
+        Director::getInstance()->getScheduler()->performFunctionInCocosThread(&MainThreadQueue::arm);
+}
+
+void MainThreadQueue::arm()
+{
+    // looked up rather than captured : the instance may have been destroyed since the function was posted
+    MainThreadQueue* instance = s_sharedMainThreadQueue.load(std::memory_order_acquire);
+    if (instance == nullptr)
+        return;
+
+    auto director = Director::getInstance();
+    auto scheduler = director->getScheduler();
+    if (!scheduler->isScheduled(SCHEDULE_KEY, instance))
+        scheduler->schedule(std::bind(&MainThreadQueue::drain, instance, std::placeholders::_1), instance, 0, false, SCHEDULE_KEY);
+    if (instance->_resetListener == nullptr)
+        instance->_resetListener = director->getEventDispatcher()->addCustomEventListener(Director::EVENT_RESET, std::bind(&MainThreadQueue::onDirectorReset, instance));
+}
+
+void MainThreadQueue::onDirectorReset()
+{
+    // Director::reset() is about to unschedule everything and remove all listeners, the drain included :
+    // the next post arms it again, and so does this function if it outlives the reset (Director::restart())
+    auto director = Director::getInstance();
+    director->getEventDispatcher()->removeEventListener(_resetListener);
+    _resetListener = nullptr;
+    _armed = false;
+    if (_pending > 0)
+        director->getScheduler()->performFunctionInCocosThread(&MainThreadQueue::arm);
+}
+
+bool MainThreadQueue::pop(std::function<void()>& function)
+{
+    Node* tail = _tail;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (next == nullptr)
+        return false;
+    function = std::move(next->function);
+    _tail = next;
+    delete tail;
+    --_pending;
+    return true;
+}
+
+void MainThreadQueue::drain(float /*dt*/)
+{
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<float>(_timeBudget.load()));
+
+    size_t count = 0;
+    bool carriedOver = false;
+    std::function<void()> function;
+    while (pop(function))
+    {
+        function();
+        ++count;
+        if (std::chrono::steady_clock::now() >= deadline)
+        {
+            carriedOver = _pending > 0;
+            break;
+        }
+    }
+
+    _lastFrameCount = count;
+    _lastDrainTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+    if (count > _maxFrameCount)
+        _maxFrameCount = count;
+    if (_lastDrainTime > _maxDrainTime)
+        _maxDrainTime = _lastDrainTime;
+    if (carriedOver)
+        ++_carriedOverFrames;
+}
+
+MainThreadQueue::Stats MainThreadQueue::getStats() const
+{
+    Stats stats;
+    stats.pending = _pending;
+    stats.lastFrameCount = _lastFrameCount;
+    stats.maxFrameCount = _maxFrameCount;
+    stats.lastDrainTime = _lastDrainTime;
+    stats.maxDrainTime = _maxDrainTime;
+    stats.carriedOverFrames = _carriedOverFrames;
+    return stats;
+}
+
+NS_CC_END
@@ -0,0 +1,130 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+#ifndef __CC_MAINTHREADQUEUE_H__
+#define __CC_MAINTHREADQUEUE_H__
+
+#include <atomic>
+#include <functional>
+
+#include "platform/CCPlatformMacros.h"
+
+NS_CC_BEGIN
+
+class EventListenerCustom;
+
+/**
+ * @addtogroup platform
+ * @{
+ */
+
+/**
+ *  Delivers functions posted from any thread to the cocos thread, in batches.
+ *
+ *  Unlike Scheduler::performFunctionInCocosThread, posting doesn't take a lock : functions go
+ *  through a lock-free queue, drained once per frame. A drain stops when its time budget is
+ *  spent, and the remaining functions are carried over to the next frame, so a burst of async
+ *  completions is spread over several frames instead of stalling one.
+ *  The drain is scheduled again after Director::reset() (and so restart()) unschedules it.
+ */
+class CC_DLL MainThreadQueue
+{
+public:
+    /** Drain counters, updated on the cocos thread. */
+    struct Stats
+    {
+        size_t pending;             // functions waiting for a drain
+        size_t lastFrameCount;      // functions run by the last drain
+        size_t maxFrameCount;
+        float lastDrainTime;        // seconds spent in the last drain
+        float maxDrainTime;
+        size_t carriedOverFrames;   // drains that ran out of budget
+    };
+
+    static MainThreadQueue* getInstance();
+
+    /**
+     *  Destroys the instance, dropping the pending functions. Must be called on the cocos thread,
+     *  once no other thread posts anymore. Called by FileUtils::destroyInstance().
+     */
+    static void destroyInstance();
+
+    /**
+     *  Queues a function to run on the cocos thread. Thread safe.
+     */
+    void post(std::function<void()> function);
+
+    /**
+     *  Sets the time a frame may spend running posted functions. At least one runs per frame.
+     *  @param seconds Defaults to 0.002.
+     */
+    void setTimeBudget(float seconds) { _timeBudget = seconds; }
+    float getTimeBudget() const { return _timeBudget; }
+
+    /**
+     *  Gets the drain counters. Must be called on the cocos thread.
+     */
+    Stats getStats() const;
+
+private:
+    struct Node
+    {
+        std::atomic<Node*> next;
+        std::function<void()> function;
+    };
+
+    MainThreadQueue();
+    ~MainThreadQueue();
+
+    static void arm();
+    void onDirectorReset();
+    bool pop(std::function<void()>& function);
+    void drain(float dt);
+
+    static std::atomic<MainThreadQueue*> s_sharedMainThreadQueue;
+
+    // intrusive multi-producer single-consumer list : producers swap _head, the cocos thread owns _tail
+    std::atomic<Node*> _head;
+    char _pad[64];
+    Node* _tail;
+
+    std::atomic<size_t> _pending;
+    std::atomic<bool> _armed;           // the drain is scheduled, or about to be
+    std::atomic<float> _timeBudget;
+    EventListenerCustom* _resetListener;
+
+    size_t _lastFrameCount;
+    size_t _maxFrameCount;
+    float _lastDrainTime;
+    float _maxDrainTime;
+    size_t _carriedOverFrames;
+};
+
+// end of support group
+/** @} */
+
+NS_CC_END
+
+#endif    // __CC_MAINTHREADQUEUE_H__
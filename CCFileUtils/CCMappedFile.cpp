@@ -0,0 +1,107 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "platform/CCMappedFile.h"
+
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+NS_CC_BEGIN
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::string& path)
+{
+    std::shared_ptr<MappedFile> file(new (std::nothrow) MappedFile());
+    if (!file)
+        return nullptr;
+
+#ifdef _WIN32
+    // FILE_SHARE_DELETE : a mapped file can still be removed or renamed over, hot updates replace them
+    file->_fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file->_fileHandle == INVALID_HANDLE_VALUE)
+        return nullptr;
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file->_fileHandle, &fileSize) || fileSize.QuadPart == 0 || fileSize.QuadPart > 0xFFFFFFFFLL)
+        return nullptr;
+    file->_mappingHandle = CreateFileMappingA(file->_fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!file->_mappingHandle)
+        return nullptr;
+    file->_bytes = (const unsigned char*)MapViewOfFile(file->_mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (!file->_bytes)
+        return nullptr;
+    file->_size = (size_t)fileSize.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return nullptr;
+    struct stat statBuf;
+    if (fstat(fd, &statBuf) == -1 || !S_ISREG(statBuf.st_mode) || statBuf.st_size == 0 || (uint64_t)statBuf.st_size > 0xFFFFFFFFULL)
+    {
+        ::close(fd);
+        return nullptr;
+    }
+    void* bytes = mmap(nullptr, (size_t)statBuf.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (bytes == MAP_FAILED)
+        return nullptr;
+    file->_bytes = (const unsigned char*)bytes;
+    file->_size = (size_t)statBuf.st_size;
+#endif
+    return file;
+}
+
+MappedFile::MappedFile()
+: _bytes(nullptr)
+, _size(0)
+#ifdef _WIN32
+, _fileHandle(INVALID_HANDLE_VALUE)
+, _mappingHandle(nullptr)
+#endif
+{
+}
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (_bytes)
+        UnmapViewOfFile(_bytes);
+    if (_mappingHandle)
+        CloseHandle(_mappingHandle);
+    if (_fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(_fileHandle);
+#else
+    if (_bytes)
+        munmap((void*)_bytes, _size);
+#endif
+}
+
+NS_CC_END
@@ -0,0 +1,113 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+#ifndef __CC_MAPPEDFILE_H__
+#define __CC_MAPPEDFILE_H__
+
+#include <string>
+#include <memory>
+
+#include "platform/CCPlatformMacros.h"
+
+NS_CC_BEGIN
+
+/**
+ * @addtogroup platform
+ * @{
+ */
+
+/**
+ *  Read-only memory mapping of a whole file. Pages are loaded lazily by the system.
+ *  Shared through std::shared_ptr : the mapping lives as long as a reference to it.
+ *  The file may be removed or replaced meanwhile, but not rewritten in place : on POSIX, accessing
+ *  the mapping of a truncated file crashes with SIGBUS.
+ */
+class CC_DLL MappedFile
+{
+public:
+    /**
+     *  Maps a file.
+     *  @param path The path of the file, as returned by FileUtils::getSuitableFOpen().
+     *  @return The mapping, or nullptr if the file can't be mapped (missing, empty, larger than 4GB).
+     */
+    static std::shared_ptr<MappedFile> open(const std::string& path);
+
+    ~MappedFile();
+
+    const unsigned char* getBytes() const { return _bytes; }
+    size_t getSize() const { return _size; }
+
+private:
+    MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const unsigned char* _bytes;
+    size_t _size;
+#ifdef _WIN32
+    void* _fileHandle;
+    void* _mappingHandle;
+#endif
+};
+
+/**
+ *  Read-only view on file content, returned by FileUtils::getMappedData() and ZipIndex::getMappedData().
+ *
+ *  The bytes either point into a MappedFile (plain files, stored zip entries), or into a decoded
+ *  heap buffer (encrypted or compressed assets). Copies share the same bytes, which stay valid
+ *  as long as one of them exists.
+ */
+class CC_DLL MappedData
+{
+public:
+    MappedData() : _bytes(nullptr), _size(0), _mapped(false) {}
+
+    /**
+     *  @param owner Keeps the bytes alive, a MappedFile or a decoded buffer.
+     *  @param mapped Whether owner is a MappedFile.
+     */
+    MappedData(std::shared_ptr<const void> owner, const unsigned char* bytes, size_t size, bool mapped)
+    : _owner(std::move(owner)), _bytes(bytes), _size(size), _mapped(mapped) {}
+
+    const unsigned char* getBytes() const { return _bytes; }
+    ssize_t getSize() const { return (ssize_t)_size; }
+    bool isNull() const { return _owner == nullptr; }
+
+    /** Checks whether the bytes are mapped from a file rather than decoded to the heap. */
+    bool isMapped() const { return _mapped; }
+
+private:
+    std::shared_ptr<const void> _owner;
+    const unsigned char* _bytes;
+    size_t _size;
+    bool _mapped;
+};
+
+// end of support group
+/** @} */
+
+NS_CC_END
+
+#endif    // __CC_MAPPEDFILE_H__
@@ -0,0 +1,141 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "platform/CCPathArena.h"
+
+#include <cstring>
+
+NS_CC_BEGIN
+
+// most paths are a few dozen bytes, a block holds a few thousands of them
+static const size_t BLOCK_SIZE = 64 * 1024;
+static const size_t INITIAL_BUCKET_COUNT = 1024;
+
+PathArena::PathArena()
+: _blockUsed(0)
+, _blockSize(0)
+, _blockBytes(0)
+{
+    Entry invalid = { "", 0, 0 };
+    _entries.push_back(invalid);
+    _buckets.resize(INITIAL_BUCKET_COUNT, 0);
+}
+
+uint32_t PathArena::hash(const char* str, size_t length)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < length; ++i)
+    {
+        h ^= (unsigned char)str[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+PathArena::Handle PathArena::find(const char* str, size_t length) const
+{
+    uint32_t h = hash(str, length);
+    size_t mask = _buckets.size() - 1;
+    for (size_t i = h & mask; _buckets[i] != 0; i = (i + 1) & mask)
+    {
+        const Entry& entry = _entries[_buckets[i]];
+        if (entry.hash == h && entry.length == length && memcmp(entry.str, str, length) == 0)
+            return _buckets[i];
+    }
+    return 0;
+}
+
+PathArena::Handle PathArena::intern(const char* str, size_t length)
+{
+    uint32_t h = hash(str, length);
+    size_t mask = _buckets.size() - 1;
+    size_t i = h & mask;
+    for (; _buckets[i] != 0; i = (i + 1) & mask)
+    {
+        const Entry& entry = _entries[_buckets[i]];
+        if (entry.hash == h && entry.length == length && memcmp(entry.str, str, length) == 0)
+            return _buckets[i];
+    }
+
+    Handle handle = (Handle)_entries.size();
+    Entry entry = { store(str, length), (uint32_t)length, h };
+    _entries.push_back(entry);
+    _buckets[i] = handle;
+    // keep the load factor under 1/2, probes stay short
+    if (_entries.size() * 2 > _buckets.size())
+        rehash(_buckets.size() * 2);
+    return handle;
+}
+
+const char* PathArena::store(const char* str, size_t length)
+{
+    size_t size = length + 1;
+    char* dst;
+    if (size > BLOCK_SIZE / 4)
+    {
+        // long strings get their own block, inserted before the current one to keep filling it
+        std::unique_ptr<char[]> block(new char[size]);
+        dst = block.get();
+        _blocks.insert(_blocks.empty() ? _blocks.end() : _blocks.end() - 1, std::move(block));
+        _blockBytes += size;
+    }
+    else
+    {
+        if (_blocks.empty() || _blockUsed + size > _blockSize)
+        {
+            _blocks.push_back(std::unique_ptr<char[]>(new char[BLOCK_SIZE]));
+            _blockUsed = 0;
+            _blockSize = BLOCK_SIZE;
+            _blockBytes += BLOCK_SIZE;
+        }
+        dst = _blocks.back().get() + _blockUsed;
+        _blockUsed += size;
+    }
+    memcpy(dst, str, length);
+    dst[length] = '\0';
+    return dst;
+}
+
+void PathArena::rehash(size_t bucketCount)
+{
+    _buckets.assign(bucketCount, 0);
+    size_t mask = bucketCount - 1;
+    for (Handle handle = 1; handle < _entries.size(); ++handle)
+    {
+        size_t i = _entries[handle].hash & mask;
+        while (_buckets[i] != 0)
+            i = (i + 1) & mask;
+        _buckets[i] = handle;
+    }
+}
+
+size_t PathArena::getMemoryUsage() const
+{
+    return _blockBytes + _entries.capacity() * sizeof(Entry) + _buckets.capacity() * sizeof(Handle);
+}
+
+NS_CC_END
@@ -0,0 +1,114 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+#ifndef __CC_PATHARENA_H__
+#define __CC_PATHARENA_H__
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+#include "platform/CCPlatformMacros.h"
+
+NS_CC_BEGIN
+
+/**
+ * @addtogroup platform
+ * @{
+ */
+
+/**
+ *  Interned strings, identified by 32-bit handles.
+ *
+ *  The characters are packed in large blocks that are never moved nor freed before the arena,
+ *  so the pointer returned by getString() stays valid. Interning the same string twice returns
+ *  the same handle. Handle 0 is never returned : it stands for "no string".
+ *
+ *  Not thread safe, FileUtils guards its arena with its own mutex.
+ */
+class CC_DLL PathArena
+{
+public:
+    typedef uint32_t Handle;
+
+    PathArena();
+
+    /**
+     *  Gets the handle of a string, adding it to the arena if needed.
+     */
+    Handle intern(const char* str, size_t length);
+    Handle intern(const std::string& str) { return intern(str.data(), str.size()); }
+
+    /**
+     *  Gets the handle of a string already interned.
+     *  @return The handle, or 0 if the string isn't in the arena.
+     */
+    Handle find(const char* str, size_t length) const;
+
+    /** Gets the characters of an interned string, followed by a '\0'. */
+    const char* getString(Handle handle) const { return _entries[handle].str; }
+    size_t getLength(Handle handle) const { return _entries[handle].length; }
+
+    /** Checks whether a handle was returned by this arena. */
+    bool isValid(Handle handle) const { return handle != 0 && handle < _entries.size(); }
+
+    /** Gets the number of interned strings. */
+    size_t getCount() const { return _entries.size() - 1; }
+
+    /** Gets the bytes used by the blocks and the tables. */
+    size_t getMemoryUsage() const;
+
+private:
+    PathArena(const PathArena&) = delete;
+    PathArena& operator=(const PathArena&) = delete;
+
+    struct Entry
+    {
+        const char* str;
+        uint32_t length;
+        uint32_t hash;
+    };
+
+    const char* store(const char* str, size_t length);
+    void rehash(size_t bucketCount);
+    static uint32_t hash(const char* str, size_t length);
+
+    std::vector<std::unique_ptr<char[]>> _blocks;
+    size_t _blockUsed;
+    size_t _blockSize;
+    size_t _blockBytes;
+
+    // _entries[0] is the invalid handle, _buckets holds handles (0 for a free bucket) with linear probing
+    std::vector<Entry> _entries;
+    std::vector<Handle> _buckets;
+};
+
+// end of support group
+/** @} */
+
+NS_CC_END
+
+#endif    // __CC_PATHARENA_H__
@@ -0,0 +1,249 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "platform/CCPlistWriter.h"
+
+#include <cstring>
+#include <algorithm>
+
+#include "base/ccMacros.h"
+#include "platform/CCCompiledPlist.h"
+
+NS_CC_BEGIN
+
+static const size_t BUFFER_SIZE = 64 * 1024;
+
+// what tinyxml2 printed before the root : the declaration, the DOCTYPE (an empty element to
+// tinyxml2, hence the "/>" and the blank line after it) and the plist element
+static const char XML_HEADER[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<!DOCTYPE plist PUBLIC \"-//Apple//DTD PLIST 1.0//EN\" \"http://www.apple.com/DTDs/PropertyList-1.0.dtd\"/>\n"
+    "\n"
+    "<plist version=\"1.0\">";
+static const char XML_FOOTER[] = "\n</plist>\n";
+
+static bool isPlistType(const Value& value)
+{
+    switch (value.getType())
+    {
+    case Value::Type::STRING:
+    case Value::Type::INTEGER:
+    case Value::Type::FLOAT:
+    case Value::Type::DOUBLE:
+    case Value::Type::BOOLEAN:
+    case Value::Type::VECTOR:
+    case Value::Type::MAP:
+        return true;
+    default:
+        return false;
+    }
+}
+
+PlistWriter::PlistWriter(FILE* fp)
+: _fp(fp)
+, _error(false)
+, _buffer(BUFFER_SIZE)
+, _used(0)
+{
+}
+
+bool PlistWriter::writeValueMap(const ValueMap& dict, const std::string& path, Format format)
+{
+    return writeFile(path, &dict, nullptr, format);
+}
+
+bool PlistWriter::writeValueVector(const ValueVector& array, const std::string& path, Format format)
+{
+    return writeFile(path, nullptr, &array, format);
+}
+
+bool PlistWriter::writeFile(const std::string& path, const ValueMap* dict, const ValueVector* array, Format format)
+{
+    // XML is written in text mode, as tinyxml2 did
+    FILE* fp = fopen(path.c_str(), format == Format::XML ? "w" : "wb");
+    if (!fp)
+        return false;
+
+    PlistWriter writer(fp);
+    if (format == Format::XML)
+    {
+        writer.write(XML_HEADER);
+        if (dict)
+            writer.writeXMLDict(*dict, 1);
+        else
+            writer.writeXMLArray(*array, 1);
+        writer.write(XML_FOOTER);
+    }
+    else if (dict)
+    {
+        CompiledPlist::encodeValueMap(*dict, writer);
+    }
+    else
+    {
+        CompiledPlist::encodeValueVector(*array, writer);
+    }
+    writer.flush();
+
+    bool ok = !writer._error;
+    if (fclose(fp) != 0)
+        ok = false;
+    return ok;
+}
+
+void PlistWriter::write(const void* bytes, size_t size)
+{
+    const char* src = static_cast<const char*>(bytes);
+    while (size > 0)
+    {
+        if (_used == _buffer.size())
+            flush();
+        size_t n = std::min(size, _buffer.size() - _used);
+        memcpy(_buffer.data() + _used, src, n);
+        _used += n;
+        src += n;
+        size -= n;
+    }
+}
+
+void PlistWriter::write(const char* str)
+{
+    write(str, strlen(str));
+}
+
+void PlistWriter::flush()
+{
+    if (_used > 0 && !_error && fwrite(_buffer.data(), 1, _used, _fp) != _used)
+        _error = true;
+    _used = 0;
+}
+
+void PlistWriter::writeIndent(int depth)
+{
+    write("\n", 1);
+    for (int i = 0; i < depth; ++i)
+        write("    ", 4);
+}
+
+void PlistWriter::writeEscaped(const std::string& text)
+{
+    // tinyxml2 got the text as a C string, and escapes &, < and > in it
+    const char* p = text.c_str();
+    const char* run = p;
+    for (; *p; ++p)
+    {
+        const char* entity;
+        switch (*p)
+        {
+        case '&': entity = "&amp;"; break;
+        case '<': entity = "&lt;"; break;
+        case '>': entity = "&gt;"; break;
+        default: continue;
+        }
+        write(run, p - run);
+        write(entity);
+        run = p + 1;
+    }
+    write(run, p - run);
+}
+
+void PlistWriter::writeXMLElement(const char* name, const std::string& text, int depth)
+{
+    writeIndent(depth);
+    write("<");
+    write(name);
+    write(">");
+    writeEscaped(text);
+    write("</");
+    write(name);
+    write(">");
+}
+
+void PlistWriter::writeXMLValue(const Value& value, int depth)
+{
+    switch (value.getType())
+    {
+    case Value::Type::STRING:
+        writeXMLElement("string", value.asString(), depth);
+        break;
+    case Value::Type::INTEGER:
+        writeXMLElement("integer", value.asString(), depth);
+        break;
+    case Value::Type::FLOAT:
+    case Value::Type::DOUBLE:
+        writeXMLElement("real", value.asString(), depth);
+        break;
+    case Value::Type::BOOLEAN:
+        writeIndent(depth);
+        write(value.asBool() ? "<true/>" : "<false/>");
+        break;
+    case Value::Type::VECTOR:
+        writeXMLArray(value.asValueVector(), depth);
+        break;
+    case Value::Type::MAP:
+        writeXMLDict(value.asValueMap(), depth);
+        break;
+    default:
+        CCLOG("This type cannot appear in property list");
+        break;
+    }
+}
+
+void PlistWriter::writeXMLDict(const ValueMap& dict, int depth)
+{
+    writeIndent(depth);
+    if (dict.empty())
+    {
+        write("<dict/>");
+        return;
+    }
+    write("<dict>");
+    for (const auto& iter : dict)
+    {
+        // the key is kept even when its value can't be written, as before
+        writeXMLElement("key", iter.first, depth + 1);
+        writeXMLValue(iter.second, depth + 1);
+    }
+    writeIndent(depth);
+    write("</dict>");
+}
+
+void PlistWriter::writeXMLArray(const ValueVector& array, int depth)
+{
+    writeIndent(depth);
+    // values that can't be written leave no child, an array of them only is empty too
+    if (std::none_of(array.begin(), array.end(), isPlistType))
+    {
+        write("<array/>");
+        return;
+    }
+    write("<array>");
+    for (const auto& value : array)
+        writeXMLValue(value, depth + 1);
+    writeIndent(depth);
+    write("</array>");
+}
+
+NS_CC_END
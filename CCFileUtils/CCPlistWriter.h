@@ -0,0 +1,109 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+#ifndef __CC_PLISTWRITER_H__
+#define __CC_PLISTWRITER_H__
+
+#include <string>
+#include <vector>
+#include <cstdio>
+
+#include "platform/CCPlatformMacros.h"
+#include "base/CCValue.h"
+
+NS_CC_BEGIN
+
+/**
+ * @addtogroup platform
+ * @{
+ */
+
+/**
+ *  Serializes a ValueMap / ValueVector straight to a file, used by FileUtils::writeValueMapToFile()
+ *  and FileUtils::writeValueVectorToFile().
+ *
+ *  Values are visited once and printed as they come through a fixed size buffer, no XML document
+ *  is built : memory stays at the buffer plus the nesting depth, whatever the size of the tree.
+ *  The XML output is byte for byte what tinyxml2's printer produced for the same values.
+ *
+ *  The compiled format (see CompiledPlist) needs its string table ahead of the values, so it
+ *  keeps one copy of each distinct key and string while writing.
+ */
+class CC_DLL PlistWriter
+{
+public:
+    enum class Format
+    {
+        XML,        // Apple XML plist
+        COMPILED,   // binary form read by CompiledPlist, loaded without parsing
+    };
+
+    /**
+     *  Writes a dictionary as the root of a plist.
+     *  @param path Path of the file, as returned by FileUtils::getSuitableFOpen().
+     *  @return false if the file can't be opened or written.
+     */
+    static bool writeValueMap(const ValueMap& dict, const std::string& path, Format format = Format::XML);
+
+    /**
+     *  Writes an array as the root of a plist.
+     *  @param path Path of the file, as returned by FileUtils::getSuitableFOpen().
+     *  @return false if the file can't be opened or written.
+     */
+    static bool writeValueVector(const ValueVector& array, const std::string& path, Format format = Format::XML);
+
+    /**
+     *  Appends bytes to the output, flushing the buffer to the file when it is full.
+     */
+    void write(const void* bytes, size_t size);
+
+private:
+    explicit PlistWriter(FILE* fp);
+    PlistWriter(const PlistWriter&) = delete;
+    PlistWriter& operator=(const PlistWriter&) = delete;
+
+    static bool writeFile(const std::string& path, const ValueMap* dict, const ValueVector* array, Format format);
+
+    void write(const char* str);
+    void flush();
+    void writeIndent(int depth);
+    void writeEscaped(const std::string& text);
+    void writeXMLElement(const char* name, const std::string& text, int depth);
+    void writeXMLValue(const Value& value, int depth);
+    void writeXMLDict(const ValueMap& dict, int depth);
+    void writeXMLArray(const ValueVector& array, int depth);
+
+    FILE* _fp;
+    bool _error;
+    std::vector<char> _buffer;
+    size_t _used;
+};
+
+// end of support group
+/** @} */
+
+NS_CC_END
+
+#endif    // __CC_PLISTWRITER_H__
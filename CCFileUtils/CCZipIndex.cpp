@@ -0,0 +1,308 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+#include "platform/CCZipIndex.h"
+
+#include <mutex>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+#include "base/ccMacros.h"
+#include "zlib.h"
+
+NS_CC_BEGIN
+
+namespace {
+    // identifies a version of an archive : a same-size rewrite within a second still changes modifiedTime or inode
+    struct FileStamp
+    {
+        int64_t modifiedTime;   // nanoseconds on POSIX, 100ns units on Windows
+        int64_t size;
+        uint64_t inode;         // 0 on Windows
+
+        bool operator==(const FileStamp& other) const
+        {
+            return modifiedTime == other.modifiedTime && size == other.size && inode == other.inode;
+        }
+    };
+
+    struct CachedIndex
+    {
+        FileStamp stamp;
+        std::shared_ptr<ZipIndex> index;    // null : the archive can't be indexed, left to minizip
+    };
+}
+
+static std::mutex s_cacheMutex;
+static std::unordered_map<std::string, CachedIndex> s_cache;
+
+static inline uint16_t readU16(const unsigned char* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t readU32(const unsigned char* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool getFileStamp(const std::string& path, FileStamp* stamp)
+{
+#ifdef _WIN32
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes))
+        return false;
+    stamp->modifiedTime = (int64_t)(((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime);
+    stamp->size = (int64_t)(((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow);
+    stamp->inode = 0;
+#else
+    struct stat statBuf;
+    if (stat(path.c_str(), &statBuf) == -1)
+        return false;
+#if defined(__APPLE__)
+    stamp->modifiedTime = (int64_t)statBuf.st_mtimespec.tv_sec * 1000000000 + statBuf.st_mtimespec.tv_nsec;
+#else
+    stamp->modifiedTime = (int64_t)statBuf.st_mtim.tv_sec * 1000000000 + statBuf.st_mtim.tv_nsec;
+#endif
+    stamp->size = (int64_t)statBuf.st_size;
+    stamp->inode = (uint64_t)statBuf.st_ino;
+#endif
+    return true;
+}
+
+std::shared_ptr<ZipIndex> ZipIndex::getIndex(const std::string& zipFilePath)
+{
+    FileStamp stamp;
+    if (!getFileStamp(zipFilePath, &stamp))
+        return nullptr;
+
+    {
+        std::lock_guard<std::mutex> guard(s_cacheMutex);
+        auto it = s_cache.find(zipFilePath);
+        // hot updates may replace an archive, a stale index would point to the old content
+        if (it != s_cache.end() && it->second.stamp == stamp)
+            return it->second.index;
+    }
+
+    // mapped and parsed without the lock, archives are looked up from several threads
+    std::shared_ptr<ZipIndex> index(new (std::nothrow) ZipIndex());
+    if (!index)
+        return nullptr;   // out of memory, not a property of the archive
+    index->_file = MappedFile::open(zipFilePath);
+    if (index->_file)
+    {
+        index->_data = index->_file->getBytes();
+        index->_size = index->_file->getSize();
+    }
+    // replaced while being mapped : neither used nor cached, the next lookup indexes the new archive
+    FileStamp mappedStamp;
+    if (!getFileStamp(zipFilePath, &mappedStamp) || !(mappedStamp == stamp))
+        return nullptr;
+    // archives which can't be indexed (zip64, unreadable ...) are cached too, not parsed at each lookup
+    if (!index->_file || (int64_t)index->_size != stamp.size || !index->parseCentralDirectory())
+        index.reset();
+
+    std::lock_guard<std::mutex> guard(s_cacheMutex);
+    CachedIndex& cached = s_cache[zipFilePath];
+    if (cached.index && cached.stamp == stamp)
+        return cached.index;   // indexed by another thread meanwhile
+    cached.stamp = stamp;
+    cached.index = index;
+    return index;
+}
+
+void ZipIndex::purgeCachedIndex(const std::string& zipFilePath)
+{
+    std::shared_ptr<ZipIndex> released;   // unmapped outside the lock
+    std::lock_guard<std::mutex> guard(s_cacheMutex);
+    auto it = s_cache.find(zipFilePath);
+    if (it == s_cache.end())
+        return;
+    released = std::move(it->second.index);
+    s_cache.erase(it);
+}
+
+void ZipIndex::purgeCache()
+{
+    std::lock_guard<std::mutex> guard(s_cacheMutex);
+    s_cache.clear();
+}
+
+ZipIndex::ZipIndex()
+: _data(nullptr)
+, _size(0)
+{
+}
+
+ZipIndex::~ZipIndex()
+{
+}
+
+bool ZipIndex::parseCentralDirectory()
+{
+    // end of central directory record : 22 bytes, followed by a comment of at most 64KB
+    const size_t eocdSize = 22;
+    if (_size < eocdSize)
+        return false;
+    size_t eocd = _size - eocdSize;
+    size_t lowest = _size > eocdSize + 0xFFFF ? _size - eocdSize - 0xFFFF : 0;
+    while (readU32(_data + eocd) != 0x06054b50)
+    {
+        if (eocd == lowest)
+            return false;
+        --eocd;
+    }
+
+    uint16_t entryCount = readU16(_data + eocd + 10);
+    uint32_t directorySize = readU32(_data + eocd + 12);
+    uint32_t directoryOffset = readU32(_data + eocd + 16);
+    if (entryCount == 0xFFFF || directoryOffset == 0xFFFFFFFF)
+        return false;   // zip64
+    if ((size_t)directoryOffset + directorySize > eocd)
+        return false;
+
+    _entries.reserve(entryCount);
+    const unsigned char* p = _data + directoryOffset;
+    const unsigned char* end = p + directorySize;
+    for (uint16_t i = 0; i < entryCount; ++i)
+    {
+        if (end - p < 46 || readU32(p) != 0x02014b50)
+            return false;
+        uint16_t flags = readU16(p + 8);
+        uint16_t nameLength = readU16(p + 28);
+        size_t headerSize = 46 + nameLength + readU16(p + 30) + readU16(p + 32);
+        if ((size_t)(end - p) < headerSize)
+            return false;
+
+        Entry entry;
+        entry.method = readU16(p + 10);
+        entry.compressedSize = readU32(p + 20);
+        entry.uncompressedSize = readU32(p + 24);
+        entry.localHeaderOffset = readU32(p + 42);
+
+        // encrypted, zip64 or exotic entries are left to minizip
+        bool supported = !(flags & 1)
+            && (entry.method == 0 || entry.method == Z_DEFLATED)
+            && entry.compressedSize != 0xFFFFFFFF && entry.uncompressedSize != 0xFFFFFFFF;
+        if (supported)
+            _entries.emplace(std::string((const char*)p + 46, nameLength), entry);
+        p += headerSize;
+    }
+    return true;
+}
+
+const unsigned char* ZipIndex::getEntryData(const Entry& entry) const
+{
+    // the local header repeats the name, and may have a different extra field than the central one
+    size_t offset = entry.localHeaderOffset;
+    if (offset + 30 > _size || readU32(_data + offset) != 0x04034b50)
+        return nullptr;
+    offset += 30 + readU16(_data + offset + 26) + readU16(_data + offset + 28);
+    if (offset + entry.compressedSize > _size)
+        return nullptr;
+    return _data + offset;
+}
+
+unsigned char* ZipIndex::getFileData(const std::string& filename, ssize_t* size) const
+{
+    *size = 0;
+    auto it = _entries.find(filename);
+    if (it == _entries.end())
+        return nullptr;
+    const Entry& entry = it->second;
+    const unsigned char* src = getEntryData(entry);
+    if (!src)
+        return nullptr;
+
+    unsigned char* buffer = (unsigned char*)malloc(entry.uncompressedSize ? entry.uncompressedSize : 1);
+    if (!buffer)
+        return nullptr;
+
+    if (entry.method == 0)
+    {
+        if (entry.compressedSize != entry.uncompressedSize)
+        {
+            free(buffer);
+            return nullptr;
+        }
+        memcpy(buffer, src, entry.uncompressedSize);
+    }
+    else
+    {
+        z_stream stream;
+        memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+        {
+            free(buffer);
+            return nullptr;
+        }
+        stream.next_in = (Bytef*)src;
+        stream.avail_in = entry.compressedSize;
+        stream.next_out = buffer;
+        stream.avail_out = entry.uncompressedSize;
+        int ret = inflate(&stream, Z_FINISH);
+        inflateEnd(&stream);
+        if (ret != Z_STREAM_END || stream.total_out != entry.uncompressedSize)
+        {
+            CCLOG("ZipIndex: failed to inflate %s", filename.c_str());
+            free(buffer);
+            return nullptr;
+        }
+    }
+
+    *size = entry.uncompressedSize;
+    return buffer;
+}
+
+const unsigned char* ZipIndex::getStoredFileData(const std::string& filename, ssize_t* size) const
+{
+    *size = 0;
+    auto it = _entries.find(filename);
+    if (it == _entries.end() || it->second.method != 0 || it->second.compressedSize != it->second.uncompressedSize)
+        return nullptr;
+    const unsigned char* src = getEntryData(it->second);
+    if (src)
+        *size = it->second.uncompressedSize;
+    return src;
+}
+
+MappedData ZipIndex::getMappedData(const std::string& filename) const
+{
+    ssize_t size = 0;
+    const unsigned char* bytes = getStoredFileData(filename, &size);
+    if (bytes)
+        return MappedData(_file, bytes, size, true);
+
+    unsigned char* buffer = getFileData(filename, &size);
+    if (!buffer)
+        return MappedData();
+    return MappedData(std::shared_ptr<unsigned char>(buffer, free), buffer, size, false);
+}
+
+NS_CC_END
@@ -0,0 +1,138 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+#ifndef __CC_ZIPINDEX_H__
+#define __CC_ZIPINDEX_H__
+
+#include <string>
+#include <memory>
+#include <unordered_map>
+#include <cstdint>
+
+#include "platform/CCPlatformMacros.h"
+#include "platform/CCMappedFile.h"
+
+NS_CC_BEGIN
+
+/**
+ * @addtogroup platform
+ * @{
+ */
+
+/**
+ *  Memory mapped zip archive, with its central directory parsed once into a hash map.
+ *
+ *  Used by FileUtils::getFileDataFromZip : looking a file up costs a hash lookup instead of
+ *  opening the archive and scanning its central directory, and stored (uncompressed) entries
+ *  can be accessed in place, without a copy.
+ *
+ *  Archives using zip64 or encryption aren't indexed, getIndex() returns nullptr for them
+ *  (remembered until they change on disk).
+ *
+ *  An indexed archive stays mapped while it is cached. Replace it with a new file (write it
+ *  elsewhere, then rename it over, or remove the old one first), never by rewriting it in place :
+ *  on POSIX, truncating a mapped file makes any access to the old mapping crash with SIGBUS.
+ *  FileUtils::writeDataToFile(), removeFile() and renameFile() drop the cached index first, so an
+ *  archive nobody else references is unmapped before it changes.
+ */
+class CC_DLL ZipIndex
+{
+public:
+    /**
+     *  Gets the index of an archive, parsing it on first use.
+     *  The index, or the failure to build one, is cached until the archive's size, modification time
+     *  (to the nanosecond where available) or inode change. Thread safe.
+     *  @param zipFilePath Full path of the archive.
+     *  @return The index, or nullptr if the archive can't be mapped or indexed.
+     */
+    static std::shared_ptr<ZipIndex> getIndex(const std::string& zipFilePath);
+
+    /**
+     *  Drops the cached index of an archive, unmapping it unless still referenced. Thread safe.
+     *  @param zipFilePath Full path of the archive, as given to getIndex().
+     */
+    static void purgeCachedIndex(const std::string& zipFilePath);
+
+    /**
+     *  Drops the cached indexes. Those still referenced stay valid until released.
+     */
+    static void purgeCache();
+
+    ~ZipIndex();
+
+    /** Checks whether the archive contains a file. */
+    bool contains(const std::string& filename) const { return _entries.find(filename) != _entries.end(); }
+
+    /**
+     *  Gets the uncompressed content of a file.
+     *  @param[out] size The size of the content, 0 on failure.
+     *  @return A buffer the caller must free(), or nullptr on failure.
+     */
+    unsigned char* getFileData(const std::string& filename, ssize_t* size) const;
+
+    /**
+     *  Gets the content of a stored (uncompressed) file in place.
+     *  @param[out] size The size of the content, 0 on failure.
+     *  @return A pointer into the mapped archive, valid as long as this index is referenced and the
+     *          archive isn't rewritten in place, or nullptr if the file doesn't exist or is compressed.
+     */
+    const unsigned char* getStoredFileData(const std::string& filename, ssize_t* size) const;
+
+    /**
+     *  Gets the content of a file as a view sharing the archive mapping if it is stored,
+     *  or as an inflated buffer if it is compressed. The view outlives the index; like
+     *  getStoredFileData(), a mapped view breaks if the archive is rewritten in place.
+     *  @return The content, null if the file doesn't exist or can't be inflated.
+     */
+    MappedData getMappedData(const std::string& filename) const;
+
+private:
+    struct Entry
+    {
+        uint32_t localHeaderOffset;
+        uint32_t compressedSize;
+        uint32_t uncompressedSize;
+        uint16_t method;
+    };
+
+    ZipIndex();
+    ZipIndex(const ZipIndex&) = delete;
+    ZipIndex& operator=(const ZipIndex&) = delete;
+
+    bool parseCentralDirectory();
+    const unsigned char* getEntryData(const Entry& entry) const;
+
+    std::shared_ptr<MappedFile> _file;
+    const unsigned char* _data;
+    size_t _size;
+    std::unordered_map<std::string, Entry> _entries;
+};
+
+// end of support group
+/** @} */
+
+NS_CC_END
+
+#endif    // __CC_ZIPINDEX_H__
@@ -0,0 +1,168 @@
+/****************************************************************************
+Copyright (c) 2010-2013 cocos2d-x.org
+Copyright (c) 2013-2016 Chukong Technologies Inc.
+Copyright (c) 2017-2018 Xiamen Yaji Software Co., Ltd.
+
+http://www.cocos2d-x.org
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+****************************************************************************/
+
+/*
+ *  Reads a set of generated files through BatchReader, on the default backend (io_uring when the kernel
+ *  has it) then on the thread pool, each time from one thread then from several threads at once,
+ *  and checks every buffer against the file content.
+ *
+ *  Built inside a cocos2d-x tree, from this directory (Linux or macOS) :
+ *      g++ -std=c++11 -pthread -I<cocos2d-x>/cocos -I.. BatchReaderTest.cpp ../CCBatchReader.cpp -o BatchReaderTest
+ *  Exits with 0 on success.
+ */
+
+#include "platform/CCBatchReader.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+USING_NS_CC;
+
+static const int FILE_COUNT = 600;
+static const int READER_THREADS = 4;
+
+static std::vector<std::string> s_paths;
+static std::vector<std::string> s_contents;
+
+static bool createFiles(const std::string& directory)
+{
+    std::mt19937 random(1);
+    for (int i = 0; i < FILE_COUNT; ++i)
+    {
+        // empty files, a few larger than a read chunk, small ones otherwise
+        size_t size = i % 50 == 0 ? 0 : (i % 97 == 0 ? (3 << 20) + random() % 1000 : random() % 20000);
+        std::string content(size, '\0');
+        for (auto& c : content)
+            c = (char)random();
+        std::string path = directory + "/f" + std::to_string(i);
+        FILE* fp = fopen(path.c_str(), "wb");
+        if (!fp)
+            return false;
+        fwrite(content.data(), 1, size, fp);
+        fclose(fp);
+        s_paths.push_back(path);
+        s_contents.push_back(content);
+    }
+    // unreadable requests are reported with a null buffer
+    s_paths.push_back(directory + "/missing");
+    s_contents.push_back("");
+    s_paths.push_back(directory);
+    s_contents.push_back("");
+    return true;
+}
+
+// reads every stride-th file from offset, returns the number of wrong buffers
+static int readAndCheck(size_t offset, size_t stride, unsigned int queueDepth)
+{
+    std::vector<BatchReader::Request> requests;
+    std::vector<size_t> indexes;
+    for (size_t i = offset; i < s_paths.size(); i += stride)
+    {
+        requests.push_back({ s_paths[i], nullptr, 0 });
+        indexes.push_back(i);
+    }
+    BatchReader::getInstance()->setQueueDepth(queueDepth);
+    BatchReader::getInstance()->read(requests);
+
+    int failures = 0;
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        const BatchReader::Request& request = requests[i];
+        const std::string& content = s_contents[indexes[i]];
+        bool ok = content.empty()
+            ? request.buffer == nullptr
+            : request.buffer != nullptr && request.size == content.size()
+                && memcmp(request.buffer, content.data(), content.size()) == 0 && request.buffer[request.size] == 0;
+        if (!ok)
+        {
+            printf("  wrong content for %s\n", request.path.c_str());
+            ++failures;
+        }
+        free(request.buffer);
+    }
+    return failures;
+}
+
+static int testBackend(const char* name)
+{
+    int failures = 0;
+    for (unsigned int queueDepth : { 1u, 4u, 32u, 128u })
+        failures += readAndCheck(0, 1, queueDepth);
+
+    // concurrent read() calls share the backend
+    std::atomic<int> concurrentFailures(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < READER_THREADS; ++t)
+    {
+        threads.emplace_back([t, &concurrentFailures]() {
+            for (int repeat = 0; repeat < 20; ++repeat)
+                concurrentFailures += readAndCheck(t, READER_THREADS + repeat % 3, 32);
+        });
+    }
+    for (auto& thread : threads)
+        thread.join();
+    failures += concurrentFailures;
+
+    printf("%s : %s\n", name, failures ? "FAILED" : "ok");
+    return failures;
+}
+
+int main()
+{
+    char directory[] = "/tmp/BatchReaderTest.XXXXXX";
+    if (!mkdtemp(directory) || !createFiles(directory))
+    {
+        printf("can't create the test files\n");
+        return 1;
+    }
+
+    int failures = 0;
+    if (BatchReader::getInstance()->getBackend() == BatchReader::Backend::IoUring)
+    {
+        failures += testBackend("io_uring");
+        if (BatchReader::getInstance()->getBackend() != BatchReader::Backend::IoUring)
+            printf("io_uring : refused by the kernel, the reads above fell back to the thread pool\n");
+    }
+    else
+    {
+        printf("io_uring : not available, skipped\n");
+    }
+    BatchReader::getInstance()->useThreadPool();
+    failures += testBackend("thread pool");
+    BatchReader::destroyInstance();
+
+    for (const auto& path : s_paths)
+        unlink(path.c_str());
+    rmdir(directory);
+    return failures ? 1 : 0;
+}
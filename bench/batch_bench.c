@@ -0,0 +1,195 @@
+/*
+    batch_bench.c - small block batch decoding benchmark
+    Copyright (C) Yann Collet 2011-2017
+
+    GPL v2 License
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+    You can contact the author at :
+    - LZ4 homepage : http://www.lz4.org
+    - LZ4 source repository : https://github.com/lz4/lz4
+*/
+
+/*
+ * Decodes many small independent blocks, one LZ4_decompress_safe() call per block,
+ * then through LZ4_decompress_batch() on the calling thread, which prefetches the next block.
+ * Blocks are script-like text : contiguous 1-3 KB chunks, then 512 bytes blocks scattered
+ * over buffers much larger than the caches.
+ *     cc -O3 -I.. batch_bench.c ../lz4.c -o batch_bench
+ */
+
+
+/*-************************************
+*  Dependencies
+**************************************/
+#include <stdlib.h>    /* malloc, free */
+#include <stdio.h>     /* printf */
+#include <string.h>    /* memcpy, memcmp */
+#include <time.h>      /* clock */
+
+#define LZ4_STATIC_LINKING_ONLY
+#include "lz4.h"
+
+
+/*-************************************
+*  Constants
+**************************************/
+#define TEXT_SIZE       (16 << 20)
+#define SCATTER_SIZE    (256 << 20)   /* per buffer, compressed and decompressed */
+#define NB_LOOPS        7
+
+
+/*-************************************
+*  Corpus
+**************************************/
+static unsigned BMK_rand(unsigned* seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return (*seed >> 16) & 0x7FFF;
+}
+
+/* lines of script source : "local name = call(name, number)", from a small vocabulary */
+static void BMK_genScript(char* dst, size_t size, unsigned seed)
+{
+    static const char* const keywords[] = { "local ", "return ", "if ", "self.", "end\n", "function " };
+    char names[128][12];
+    size_t i = 0;
+    int n;
+    for (n = 0; n < 128; n++) {
+        int const length = 3 + BMK_rand(&seed) % 8;
+        int c;
+        for (c = 0; c < length; c++) names[n][c] = (char)('a' + BMK_rand(&seed) % 26);
+        names[n][length] = 0;
+    }
+    while (i < size) {
+        char line[128];
+        int const length = sprintf(line, "%s%s = %s(%s, %u)\n",
+                                   keywords[BMK_rand(&seed) % 6], names[BMK_rand(&seed) % 128],
+                                   names[BMK_rand(&seed) % 128], names[BMK_rand(&seed) % 128], BMK_rand(&seed) % 1000);
+        size_t const copy = (size - i < (size_t)length) ? size - i : (size_t)length;
+        memcpy(dst + i, line, copy);
+        i += copy;
+    }
+}
+
+
+/*-************************************
+*  Benchmark
+**************************************/
+static double BMK_time(LZ4_batchItem_t* items, int nbItems, int batched)
+{
+    double best = 0;
+    int loop;
+    for (loop = 0; loop < NB_LOOPS; loop++) {
+        clock_t const start = clock();
+        double seconds;
+        if (batched) {
+            LZ4_decompress_batch(items, nbItems, NULL);
+        } else {
+            int i;
+            for (i = 0; i < nbItems; i++)
+                items[i].result = LZ4_decompress_safe(items[i].src, items[i].dst, items[i].srcSize, items[i].dstCapacity);
+        }
+        seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+        if (seconds > 0 && (best == 0 || seconds < best)) best = seconds;
+    }
+    return best;
+}
+
+/* compresses the blocks of `text` described by items[].dstCapacity into `cBuffer`, at `cOffsets`, and decodes them to `dBuffer`, at `dOffsets` */
+static int BMK_run(const char* name, const char* text, LZ4_batchItem_t* items, int nbItems,
+                   char* cBuffer, const size_t* cOffsets, char* dBuffer, const size_t* dOffsets)
+{
+    size_t total = 0;
+    double serial, batched;
+    int i;
+    for (i = 0; i < nbItems; i++) {
+        char* const cDst = cBuffer + cOffsets[i];
+        items[i].src = cDst;
+        items[i].srcSize = LZ4_compress_default(text + total, cDst, items[i].dstCapacity, LZ4_compressBound(items[i].dstCapacity));
+        items[i].dst = dBuffer + dOffsets[i];
+        total += (size_t)items[i].dstCapacity;
+    }
+    serial = BMK_time(items, nbItems, 0);
+    batched = BMK_time(items, nbItems, 1);
+    total = 0;
+    for (i = 0; i < nbItems; i++) {
+        if (items[i].result != items[i].dstCapacity || memcmp(items[i].dst, text + total, (size_t)items[i].dstCapacity)) {
+            printf("%s : block %d decoded wrong \n", name, i);
+            return 1;
+        }
+        total += (size_t)items[i].dstCapacity;
+    }
+    printf("%-34s serial %7.1f MB/s   batch %7.1f MB/s \n", name,
+           serial > 0 ? total / serial / 1000000 : 0, batched > 0 ? total / batched / 1000000 : 0);
+    return 0;
+}
+
+int main(void)
+{
+    int const maxItems = TEXT_SIZE / 512;
+    char* const text = (char*)malloc(TEXT_SIZE);
+    char* const cBuffer = (char*)malloc(SCATTER_SIZE);
+    char* const dBuffer = (char*)malloc(SCATTER_SIZE);
+    LZ4_batchItem_t* const items = (LZ4_batchItem_t*)calloc((size_t)maxItems, sizeof(LZ4_batchItem_t));
+    size_t* const cOffsets = (size_t*)malloc((size_t)maxItems * sizeof(size_t));
+    size_t* const dOffsets = (size_t*)malloc((size_t)maxItems * sizeof(size_t));
+    unsigned seed = 7;
+    int nbItems;
+    int error = 0;
+    int i;
+    if (!text || !cBuffer || !dBuffer || !items || !cOffsets || !dOffsets) { printf("not enough memory \n"); return 1; }
+    BMK_genScript(text, TEXT_SIZE, 1);
+    memset(cBuffer, 0, SCATTER_SIZE);
+    memset(dBuffer, 0, SCATTER_SIZE);
+
+    /* 1-3 KB chunks, one after the other */
+    {   size_t cPos = 0, dPos = 0;
+        for (nbItems = 0; ; nbItems++) {
+            int const size = 1024 + (int)(BMK_rand(&seed) % 2048);
+            if (dPos + (size_t)size > TEXT_SIZE) break;
+            items[nbItems].dstCapacity = size;
+            cOffsets[nbItems] = cPos;
+            dOffsets[nbItems] = dPos;
+            cPos += (size_t)LZ4_compressBound(size);
+            dPos += (size_t)size;
+    }   }
+    error |= BMK_run("1-3 KB blocks, contiguous", text, items, nbItems, cBuffer, cOffsets, dBuffer, dOffsets);
+
+    /* 512 bytes blocks, each at a random 4 KB slot of the buffers */
+    nbItems = maxItems;
+    for (i = 0; i < nbItems; i++) {
+        items[i].dstCapacity = 512;
+        cOffsets[i] = (size_t)i * 4096;
+        dOffsets[i] = (size_t)i * 4096;
+    }
+    for (i = nbItems - 1; i > 0; i--) {   /* independent shuffles of both */
+        unsigned const rc = (BMK_rand(&seed) << 15 | BMK_rand(&seed)) % (unsigned)(i + 1);
+        unsigned const rd = (BMK_rand(&seed) << 15 | BMK_rand(&seed)) % (unsigned)(i + 1);
+        size_t const c = cOffsets[i], d = dOffsets[i];
+        cOffsets[i] = cOffsets[rc]; cOffsets[rc] = c;
+        dOffsets[i] = dOffsets[rd]; dOffsets[rd] = d;
+    }
+    error |= BMK_run("512 B blocks, scattered", text, items, nbItems, cBuffer, cOffsets, dBuffer, dOffsets);
+
+    free(text);
+    free(cBuffer);
+    free(dBuffer);
+    free(items);
+    free(cOffsets);
+    free(dOffsets);
+    return error;
+}
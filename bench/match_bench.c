@@ -0,0 +1,177 @@
+/*
+    match_bench.c - match length counting benchmark
+    Copyright (C) Yann Collet 2011-2017
+
+    GPL v2 License
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+    You can contact the author at :
+    - LZ4 homepage : http://www.lz4.org
+    - LZ4 source repository : https://github.com/lz4/lz4
+*/
+
+/*
+ * Measures LZ4_count() and LZ4HC_countBack() through the block compressors,
+ * on corpora whose matches are long (where comparing 16/32 bytes per step pays)
+ * and on a short match corpus (where it must not cost anything).
+ *
+ * Build it twice, with and without the vector compares, then compare the speeds.
+ * Compressed sizes must be identical between the two builds :
+ *     cc -O3 -I.. match_bench.c ../lz4.c ../lz4hc.c -o match_bench
+ *     cc -O3 -I.. -DLZ4_VECTOR_COUNT=0 match_bench.c ../lz4.c ../lz4hc.c -o match_bench_scalar
+ *
+ * The fast compressor is run on every CPU variant the build and the CPU support :
+ * only the AVX2 one uses the 32 bytes compare.
+ */
+
+
+/*-************************************
+*  Dependencies
+**************************************/
+#include <stdlib.h>    /* malloc, free */
+#include <stdio.h>     /* printf */
+#include <string.h>    /* memcpy */
+#include <time.h>      /* clock */
+
+#define LZ4_STATIC_LINKING_ONLY
+#include "lz4.h"
+#include "lz4hc.h"
+
+
+/*-************************************
+*  Constants
+**************************************/
+#define CORPUS_SIZE   (8 << 20)
+#define NB_LOOPS      5
+#define HC_LEVEL      9
+
+
+/*-************************************
+*  Corpora
+**************************************/
+static unsigned BMK_rand(unsigned* seed)
+{
+    *seed = *seed * 1103515245 + 12345;
+    return (*seed >> 16) & 0x7FFF;
+}
+
+/* a 32 KB random block, repeated with one byte changed every 4 KB : matches of about 4 KB, 32 KB back */
+static void BMK_genLongDistance(char* dst, size_t size, unsigned seed)
+{
+    size_t const period = 32 << 10;
+    size_t i;
+    for (i = 0; i < size; i++)
+        dst[i] = (i < period) ? (char)BMK_rand(&seed) : dst[i - period];
+    for (i = period; i < size; i += 4 << 10)
+        dst[i + BMK_rand(&seed) % 64] ^= 0x5A;
+}
+
+/* 512 bytes records differing only by a 4 bytes id : matches of about 500 bytes, one record back */
+static void BMK_genRecords(char* dst, size_t size, unsigned seed)
+{
+    char record[512];
+    size_t i;
+    unsigned id = 0;
+    for (i = 0; i < sizeof(record); i++) record[i] = (char)('a' + BMK_rand(&seed) % 26);
+    for (i = 0; i < size; i += sizeof(record)) {
+        size_t const length = (size - i < sizeof(record)) ? size - i : sizeof(record);
+        memcpy(record + 100, &id, sizeof(id));
+        id++;
+        memcpy(dst + i, record, length);
+    }
+}
+
+/* words drawn from a small vocabulary : mostly short matches */
+static void BMK_genWords(char* dst, size_t size, unsigned seed)
+{
+    char vocabulary[256][8];
+    size_t i = 0;
+    int w;
+    for (w = 0; w < 256; w++) {
+        int c;
+        for (c = 0; c < 7; c++) vocabulary[w][c] = (char)('a' + BMK_rand(&seed) % 26);
+        vocabulary[w][7] = ' ';
+    }
+    while (i < size) {
+        const char* const word = vocabulary[BMK_rand(&seed) % 256];
+        size_t const length = 2 + BMK_rand(&seed) % 7;   /* 1 to 7 letters, then a space */
+        size_t c;
+        for (c = 0; c < length && i < size; c++) dst[i++] = word[8 - length + c];
+    }
+}
+
+
+/*-************************************
+*  Benchmark
+**************************************/
+typedef int (*compressor_f)(const char* src, char* dst, int srcSize, int dstCapacity);
+
+static int BMK_compressFast(const char* src, char* dst, int srcSize, int dstCapacity)
+{
+    return LZ4_compress_default(src, dst, srcSize, dstCapacity);
+}
+
+static int BMK_compressHC(const char* src, char* dst, int srcSize, int dstCapacity)
+{
+    return LZ4_compress_HC(src, dst, srcSize, dstCapacity, HC_LEVEL);
+}
+
+static void BMK_run(const char* name, compressor_f compressor, const char* src, char* dst, int srcSize)
+{
+    int const dstCapacity = LZ4_compressBound(srcSize);
+    double best = 0;
+    int cSize = 0;
+    int loop;
+    for (loop = 0; loop < NB_LOOPS; loop++) {
+        clock_t const start = clock();
+        double seconds;
+        cSize = compressor(src, dst, srcSize, dstCapacity);
+        seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+        if (seconds > 0 && (best == 0 || seconds < best)) best = seconds;
+    }
+    printf("  %-22s %9d bytes  %8.1f MB/s\n", name, cSize, best > 0 ? srcSize / best / 1000000 : 0);
+}
+
+int main(void)
+{
+    static const char* const variantNames[LZ4_cpu_count] = { "fast, baseline", "fast, sse4.1", "fast, avx2" };
+    const char* corpusNames[3] = { "long distance", "records", "words" };
+    char* const src = (char*)malloc(CORPUS_SIZE);
+    char* const dst = (char*)malloc(LZ4_COMPRESSBOUND(CORPUS_SIZE));
+    int c;
+    if (!src || !dst) { printf("not enough memory \n"); return 1; }
+
+    for (c = 0; c < 3; c++) {
+        int v;
+        switch (c) {
+        case 0: BMK_genLongDistance(src, CORPUS_SIZE, 1); break;
+        case 1: BMK_genRecords(src, CORPUS_SIZE, 2); break;
+        default: BMK_genWords(src, CORPUS_SIZE, 3); break;
+        }
+        printf("%s, %d bytes \n", corpusNames[c], CORPUS_SIZE);
+        for (v = LZ4_cpu_baseline; v < LZ4_cpu_count; v++) {
+            if (!LZ4_isCpuVariantSupported((LZ4_cpuVariant_e)v)) continue;
+            LZ4_setCpuVariant((LZ4_cpuVariant_e)v);
+            BMK_run(variantNames[v], BMK_compressFast, src, dst, CORPUS_SIZE);
+        }
+        LZ4_setCpuVariant(LZ4_cpu_auto);
+        BMK_run("HC", BMK_compressHC, src, dst, CORPUS_SIZE);
+    }
+
+    free(src);
+    free(dst);
+    return 0;
+}
@@ -78,6 +78,64 @@
 #  endif
 #endif
 
+/*
+ * LZ4_DISPATCH
+ * Compile the block compression and decompression kernels once per instruction set
+ * (baseline, SSE4.1, AVX2+BMI2) from the same source, and select at startup the best one the CPU supports.
+ * The binary itself keeps targeting the baseline ABI.
+ * Enabled by default for gcc and clang on x86 / x86-64. Define LZ4_DISPATCH=0 to disable it.
+ */
+#ifndef LZ4_DISPATCH   /* can be defined externally */
+#  if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || (defined(__GNUC__) && (__GNUC__ >= 5)))
+#    define LZ4_DISPATCH 1
+#  else
+#    define LZ4_DISPATCH 0
+#  endif
+#endif
+
+/*
+ * LZ4_VECTOR_COUNT
+ * Extend matches 16 bytes at a time with SSE2 compares (LZ4_count(), LZ4HC_countBack()),
+ * instead of one register at a time. SSE2 is part of the x86-64 baseline.
+ * Define LZ4_VECTOR_COUNT=0 to disable it.
+ */
+#ifndef LZ4_VECTOR_COUNT   /* can be defined externally */
+#  if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#    define LZ4_VECTOR_COUNT 1
+#  else
+#    define LZ4_VECTOR_COUNT 0
+#  endif
+#endif
+
+/*
+ * LZ4_FAST_DEC_LOOP
+ * Decode blocks with a fast loop while input and output are far from their ends
+ * (unconditional 16-byte copies, no per-copy bounds checks), and finish them with the careful loop.
+ * Enabled by default on x86 and aarch64. Define LZ4_FAST_DEC_LOOP=0 to disable it.
+ */
+#ifndef LZ4_FAST_DEC_LOOP   /* can be defined externally */
+#  if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64) || defined(__aarch64__)
+#    define LZ4_FAST_DEC_LOOP 1
+#  else
+#    define LZ4_FAST_DEC_LOOP 0
+#  endif
+#endif
+
+/*
+ * LZ4_BATCH_THREADS
+ * Let LZ4_compress_batch() spread its shards over internal threads (pthreads, or Win32 threads),
+ * when LZ4_batchOptions_t::nbThreads > 1 and no runner is provided.
+ * Enabled by default on Windows and POSIX systems. Define LZ4_BATCH_THREADS=0 to build without threads :
+ * shards then run on the caller's runner only, or one after the other.
+ */
+#ifndef LZ4_BATCH_THREADS   /* can be defined externally */
+#  if defined(_WIN32) || defined(__unix__) || defined(__unix) || (defined(__APPLE__) && defined(__MACH__))
+#    define LZ4_BATCH_THREADS 1
+#  else
+#    define LZ4_BATCH_THREADS 0
+#  endif
+#endif
+
 /*
  * LZ4_FORCE_SW_BITCOUNT
  * Define this parameter if your target system or compiler does not support hardware bit count
@@ -144,6 +202,18 @@
 #  define LZ4_FORCE_O2_INLINE_GCC_PPC64LE static
 #endif
 
+#if LZ4_VECTOR_COUNT
+#  include <emmintrin.h>   /* SSE2 */
+#endif
+#if LZ4_DISPATCH
+#  include <immintrin.h>   /* AVX2, enabled per function */
+#endif
+
+#if LZ4_DISPATCH
+#  define LZ4_TARGET_SSE41 __attribute__((target("sse4.1")))
+#  define LZ4_TARGET_AVX2  __attribute__((target("avx2,bmi,bmi2")))
+#endif
+
 #if (defined(__GNUC__) && (__GNUC__ >= 3)) || (defined(__INTEL_COMPILER) && (__INTEL_COMPILER >= 800)) || defined(__clang__)
 #  define expect(expr,value)    (__builtin_expect ((expr),(value)) )
 #else
@@ -157,17 +227,34 @@
 #define unlikely(expr)   expect((expr) != 0, 0)
 #endif
 
+#if (defined(__GNUC__) && (__GNUC__ >= 3)) || defined(__clang__)
+#  define LZ4_PREFETCH(ptr)     __builtin_prefetch(ptr)
+#else
+#  define LZ4_PREFETCH(ptr)     {}
+#endif
+
 
 /*-************************************
 *  Memory routines
 **************************************/
-#include <stdlib.h>   /* malloc, calloc, free */
+#include <stdlib.h>   /* malloc, calloc, free, qsort */
 #define ALLOC(s)          malloc(s)
 #define ALLOC_AND_ZERO(s) calloc(1,s)
 #define FREEMEM(p)        free(p)
 #include <string.h>   /* memset, memcpy */
 #define MEM_INIT(p,v,s)   memset((p),(v),(s))
 
+#if LZ4_BATCH_THREADS && !defined(LZ4_COMMONDEFS_ONLY)
+#  if defined(_WIN32)
+#    ifndef WIN32_LEAN_AND_MEAN
+#      define WIN32_LEAN_AND_MEAN
+#    endif
+#    include <windows.h>   /* CreateThread, WaitForSingleObject */
+#  else
+#    include <pthread.h>   /* pthread_create, pthread_join */
+#  endif
+#endif
+
 
 /*-************************************
 *  Basic Types
@@ -416,6 +503,20 @@ static unsigned LZ4_NbCommonBytes (reg_t val)
     }
 }
 
+#if LZ4_VECTOR_COUNT || LZ4_DISPATCH
+/* index of the lowest set bit of a non-zero compare mask (bit n <=> byte n) */
+LZ4_FORCE_INLINE unsigned LZ4_lowBit32(U32 val)
+{
+#  if defined(_MSC_VER)
+    unsigned long r;
+    _BitScanForward(&r, val);
+    return (unsigned)r;
+#  else
+    return (unsigned)__builtin_ctz(val);
+#  endif
+}
+#endif
+
 #define STEPSIZE sizeof(reg_t)
 LZ4_FORCE_INLINE
 unsigned LZ4_count(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
@@ -430,6 +531,18 @@ unsigned LZ4_count(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
             return LZ4_NbCommonBytes(diff);
     }   }
 
+#if LZ4_VECTOR_COUNT
+    /* long match : 16 bytes per step, the first mismatch is the lowest bit of the inequality mask */
+    while (likely(pIn < pInLimit-15)) {
+        __m128i const in = _mm_loadu_si128((const __m128i*)pIn);
+        __m128i const match = _mm_loadu_si128((const __m128i*)pMatch);
+        U32 const neq = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(in, match)) ^ 0xFFFF;
+        if (!neq) { pIn+=16; pMatch+=16; continue; }
+        pIn += LZ4_lowBit32(neq);
+        return (unsigned)(pIn - pStart);
+    }
+#endif
+
     while (likely(pIn < pInLimit-(STEPSIZE-1))) {
         reg_t const diff = LZ4_read_ARCH(pMatch) ^ LZ4_read_ARCH(pIn);
         if (!diff) { pIn+=STEPSIZE; pMatch+=STEPSIZE; continue; }
@@ -444,6 +557,69 @@ unsigned LZ4_count(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
 }
 
 
+/*-************************************
+*  Dictionary blobs
+**************************************/
+/* A dictionary blob is the state of a stream primed with a dictionary, saved once, then loaded in O(1) :
+ * [header, LZ4_DICTBLOB_HEADERSIZE bytes][stream state, stateSize bytes][dictionary, dictSize bytes]
+ * Tables only hold indexes, but the state's pointers are only valid in the process which saved it :
+ * they are saved as offsets from the dictionary, and patched in place when the blob is loaded. */
+#define LZ4_DICTBLOB_MAGIC      0x44345A4CU   /* "LZ4D" */
+#define LZ4_DICTBLOB_ENDIANNESS 0x01020304U
+#define LZ4_DICTBLOB_HEADERSIZE 64
+#define LZ4_DICTBLOB_STREAM     1   /* LZ4_stream_t */
+#define LZ4_DICTBLOB_STREAMHC   2   /* LZ4_streamHC_t */
+
+typedef struct {
+    U32 magic;
+    U32 versionNumber;    /* LZ4_VERSION_NUMBER : stream states are private to a library version */
+    U32 endianness;       /* LZ4_DICTBLOB_ENDIANNESS, in the byte order of the machine which saved the blob */
+    U16 pointerSize;
+    U16 kind;
+    U32 stateSize;
+    U32 dictSize;
+    U32 endOffset;        /* LZ4_streamHC_t pointers : end - dictionary */
+    U32 baseOffset;       /* dictionary - base */
+    U32 dictBaseOffset;   /* dictionary - dictBase */
+} LZ4_dictBlobHeader_t;
+
+LZ4_FORCE_INLINE void LZ4_writeDictBlobHeader(void* blob, U16 kind, size_t stateSize, size_t dictSize,
+                                              U32 endOffset, U32 baseOffset, U32 dictBaseOffset)
+{
+    LZ4_dictBlobHeader_t header;
+    LZ4_STATIC_ASSERT(sizeof(LZ4_dictBlobHeader_t) <= LZ4_DICTBLOB_HEADERSIZE);
+    MEM_INIT(blob, 0, LZ4_DICTBLOB_HEADERSIZE);
+    header.magic = LZ4_DICTBLOB_MAGIC;
+    header.versionNumber = LZ4_VERSION_NUMBER;
+    header.endianness = LZ4_DICTBLOB_ENDIANNESS;
+    header.pointerSize = (U16)sizeof(void*);
+    header.kind = kind;
+    header.stateSize = (U32)stateSize;
+    header.dictSize = (U32)dictSize;
+    header.endOffset = endOffset;
+    header.baseOffset = baseOffset;
+    header.dictBaseOffset = dictBaseOffset;
+    memcpy(blob, &header, sizeof(header));
+}
+
+/* LZ4_readDictBlobHeader() :
+ * @return : 1 if `blob` holds a `kind` state saved by this library version, on a machine with the same
+ *           byte order and pointer size, and is large enough for it; 0 otherwise */
+LZ4_FORCE_INLINE int LZ4_readDictBlobHeader(LZ4_dictBlobHeader_t* header, const void* blob, size_t blobSize, U16 kind)
+{
+    if ((blob == NULL) || (blobSize < LZ4_DICTBLOB_HEADERSIZE)) return 0;
+    if (((uptrval)blob & 7) != 0) return 0;   /* states hold 64-bit fields */
+    memcpy(header, blob, sizeof(*header));
+    if ( (header->magic != LZ4_DICTBLOB_MAGIC)
+      || (header->versionNumber != LZ4_VERSION_NUMBER)
+      || (header->endianness != LZ4_DICTBLOB_ENDIANNESS)
+      || (header->pointerSize != sizeof(void*))
+      || (header->kind != kind)
+      || (header->dictSize > 64 KB)
+      || ((header->stateSize & 7) != 0) ) return 0;
+    return (blobSize - LZ4_DICTBLOB_HEADERSIZE) >= (size_t)header->stateSize + header->dictSize;
+}
+
 #ifndef LZ4_COMMONDEFS_ONLY
 /*-************************************
 *  Local Constants
@@ -483,6 +659,26 @@ typedef enum { clearedTable = 0, byPtr, byU32, byU16 } tableType_t;
  */
 typedef enum { noDict = 0, withPrefix64k, usingExtDict, usingDictCtx } dict_directive;
 typedef enum { noDictIssue = 0, dictSmall } dictIssue_directive;
+typedef enum { count_default = 0, count_avx2 } matchCount_directive;
+
+/* Kernels : the hot loops, run through LZ4_kernels() which selects their variant for the running CPU */
+#if LZ4_DISPATCH
+typedef int (*LZ4_compressKernel_f)(LZ4_stream_t_internal* cctx, const char* src, char* dst, int srcSize, int dstCapacity,
+                                    limitedOutput_directive outputLimited, tableType_t tableType,
+                                    dictIssue_directive dictIssue, int acceleration);
+typedef int (*LZ4_decompressKernel_f)(const char* src, char* dst, int srcSize, int dstCapacity,
+                                      dict_directive dict, const BYTE* lowPrefix, const BYTE* dictStart, size_t dictSize);
+typedef struct {
+    LZ4_compressKernel_f compress_noDict;
+    LZ4_decompressKernel_f decompress_safe;
+} LZ4_kernels_t;
+static const LZ4_kernels_t* LZ4_kernels(void);
+#  define LZ4_COMPRESS_NODICT    (LZ4_kernels()->compress_noDict)
+#  define LZ4_DECOMPRESS_SAFE    (LZ4_kernels()->decompress_safe)
+#else
+#  define LZ4_COMPRESS_NODICT    LZ4_compress_noDict_baseline
+#  define LZ4_DECOMPRESS_SAFE    LZ4_decompress_safe_baseline
+#endif
 
 
 /*-************************************
@@ -491,6 +687,11 @@ typedef enum { noDictIssue = 0, dictSmall } dictIssue_directive;
 int LZ4_versionNumber (void) { return LZ4_VERSION_NUMBER; }
 const char* LZ4_versionString(void) { return LZ4_VERSION_STRING; }
 int LZ4_compressBound(int isize)  { return LZ4_COMPRESSBOUND(isize); }
+int LZ4_decompressInplaceBufferSize(int dsize)
+{
+    if ((unsigned)dsize > (unsigned)LZ4_MAX_INPUT_SIZE) return 0;
+    return LZ4_DECOMPRESS_INPLACE_BUFFER_SIZE(dsize);
+}
 int LZ4_sizeofState() { return LZ4_STREAMSIZE; }
 
 
@@ -512,29 +713,55 @@ int LZ4_decompress_safe_forceExtDict(const char* in, char* out, int inSize, int
 /*-******************************
 *  Compression functions
 ********************************/
-static U32 LZ4_hash4(U32 sequence, tableType_t const tableType)
+/* hashLog : number of U32 entries of the table, as a log2 (LZ4_HASHLOG, unless set by LZ4_initStreamHashLog()).
+ * byU16 tables hold twice as many entries in the same space. */
+static U32 LZ4_hash4(U32 sequence, tableType_t const tableType, U32 const hashLog)
 {
     if (tableType == byU16)
-        return ((sequence * 2654435761U) >> ((MINMATCH*8)-(LZ4_HASHLOG+1)));
+        return ((sequence * 2654435761U) >> ((MINMATCH*8)-(hashLog+1)));
     else
-        return ((sequence * 2654435761U) >> ((MINMATCH*8)-LZ4_HASHLOG));
+        return ((sequence * 2654435761U) >> ((MINMATCH*8)-hashLog));
 }
 
-static U32 LZ4_hash5(U64 sequence, tableType_t const tableType)
+static U32 LZ4_hash5(U64 sequence, tableType_t const tableType, U32 const tableHashLog)
 {
     static const U64 prime5bytes = 889523592379ULL;
     static const U64 prime8bytes = 11400714785074694791ULL;
-    const U32 hashLog = (tableType == byU16) ? LZ4_HASHLOG+1 : LZ4_HASHLOG;
+    const U32 hashLog = (tableType == byU16) ? tableHashLog+1 : tableHashLog;
     if (LZ4_isLittleEndian())
         return (U32)(((sequence << 24) * prime5bytes) >> (64 - hashLog));
     else
         return (U32)(((sequence >> 24) * prime8bytes) >> (64 - hashLog));
 }
 
-LZ4_FORCE_INLINE U32 LZ4_hashPosition(const void* const p, tableType_t const tableType)
+LZ4_FORCE_INLINE U32 LZ4_hashPosition(const void* const p, tableType_t const tableType, U32 const hashLog)
 {
-    if ((sizeof(reg_t)==8) && (tableType != byU16)) return LZ4_hash5(LZ4_read_ARCH(p), tableType);
-    return LZ4_hash4(LZ4_read32(p), tableType);
+    if ((sizeof(reg_t)==8) && (tableType != byU16)) return LZ4_hash5(LZ4_read_ARCH(p), tableType, hashLog);
+    return LZ4_hash4(LZ4_read32(p), tableType, hashLog);
+}
+
+/* LZ4_streamHashLog() :
+ * hash log of a stream, LZ4_HASHLOG unless it was set up by LZ4_initStreamHashLog() */
+LZ4_FORCE_INLINE U32 LZ4_streamHashLog(const LZ4_stream_t_internal* cctx)
+{
+    return cctx->hashLog ? cctx->hashLog : LZ4_HASHLOG;
+}
+
+/* LZ4_hashTableOf() :
+ * tables up to the default size use the one embedded in LZ4_stream_t,
+ * larger ones are stored right after the LZ4_stream_t (see LZ4_STREAMSIZE_HASHLOG()) */
+LZ4_FORCE_INLINE void* LZ4_hashTableOf(LZ4_stream_t_internal* cctx, U32 const hashLog)
+{
+    if (hashLog <= LZ4_HASHLOG) return cctx->hashTable;
+    return (LZ4_stream_t*)cctx + 1;
+}
+
+/* LZ4_constHashTableOf() :
+ * same as LZ4_hashTableOf(), for contexts only read from (dictCtx) */
+LZ4_FORCE_INLINE const void* LZ4_constHashTableOf(const LZ4_stream_t_internal* cctx, U32 const hashLog)
+{
+    if (hashLog <= LZ4_HASHLOG) return cctx->hashTable;
+    return (const LZ4_stream_t*)cctx + 1;
 }
 
 static void LZ4_putIndexOnHash(U32 idx, U32 h, void* tableBase, tableType_t const tableType)
@@ -562,9 +789,9 @@ static void LZ4_putPositionOnHash(const BYTE* p, U32 h,
     }
 }
 
-LZ4_FORCE_INLINE void LZ4_putPosition(const BYTE* p, void* tableBase, tableType_t tableType, const BYTE* srcBase)
+LZ4_FORCE_INLINE void LZ4_putPosition(const BYTE* p, void* tableBase, tableType_t tableType, const BYTE* srcBase, U32 const hashLog)
 {
-    U32 const h = LZ4_hashPosition(p, tableType);
+    U32 const h = LZ4_hashPosition(p, tableType, hashLog);
     LZ4_putPositionOnHash(p, h, tableBase, tableType, srcBase);
 }
 
@@ -579,12 +806,12 @@ static U32 LZ4_getIndexOnHash(U32 h, const void* tableBase, tableType_t tableTyp
     LZ4_STATIC_ASSERT(LZ4_MEMORY_USAGE > 2);
     if (tableType == byU32) {
         const U32* const hashTable = (const U32*) tableBase;
-        assert(h < (1U << (LZ4_MEMORY_USAGE-2)));
+        assert(h < (1U << LZ4_HASHLOG_MAX));
         return hashTable[h];
     }
     if (tableType == byU16) {
         const U16* const hashTable = (const U16*) tableBase;
-        assert(h < (1U << (LZ4_MEMORY_USAGE-1)));
+        assert(h < (1U << (LZ4_HASHLOG_MAX+1)));
         return hashTable[h];
     }
     assert(0); return 0;  /* forbidden case */
@@ -599,9 +826,9 @@ static const BYTE* LZ4_getPositionOnHash(U32 h, const void* tableBase, tableType
 
 LZ4_FORCE_INLINE const BYTE* LZ4_getPosition(const BYTE* p,
                                              const void* tableBase, tableType_t tableType,
-                                             const BYTE* srcBase)
+                                             const BYTE* srcBase, U32 const hashLog)
 {
-    U32 const h = LZ4_hashPosition(p, tableType);
+    U32 const h = LZ4_hashPosition(p, tableType, hashLog);
     return LZ4_getPositionOnHash(h, tableBase, tableType, srcBase);
 }
 
@@ -620,8 +847,9 @@ LZ4_FORCE_INLINE void LZ4_prepareTable(
           || tableType == byPtr
           || inputSize >= 4 KB)
         {
+            U32 const hashLog = LZ4_streamHashLog(cctx);
             DEBUGLOG(4, "LZ4_prepareTable: Resetting table in %p", cctx);
-            MEM_INIT(cctx->hashTable, 0, LZ4_HASHTABLESIZE);
+            MEM_INIT(LZ4_hashTableOf(cctx, hashLog), 0, (size_t)4 << hashLog);
             cctx->currentOffset = 0;
             cctx->tableType = clearedTable;
         } else {
@@ -644,6 +872,44 @@ LZ4_FORCE_INLINE void LZ4_prepareTable(
     cctx->dictSize = 0;
 }
 
+#if LZ4_DISPATCH
+/* LZ4_count_avx2() :
+ * LZ4_count() 32 bytes per step, for matches already known to be longer than STEPSIZE.
+ * Only reached from the AVX2 kernel, see LZ4_countMatch(). */
+LZ4_TARGET_AVX2
+static unsigned LZ4_count_avx2(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit)
+{
+    const BYTE* const pStart = pIn;
+
+    while (likely(pIn < pInLimit-31)) {
+        __m256i const in = _mm256_loadu_si256((const __m256i*)pIn);
+        __m256i const match = _mm256_loadu_si256((const __m256i*)pMatch);
+        U32 const neq = ~(U32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(in, match));
+        if (!neq) { pIn+=32; pMatch+=32; continue; }
+        pIn += LZ4_lowBit32(neq);
+        return (unsigned)(pIn - pStart);
+    }
+    /* tail, less than 32 bytes before pInLimit */
+    return (unsigned)(pIn - pStart) + LZ4_count(pIn, pMatch, pInLimit);
+}
+#endif
+
+/* LZ4_countMatch() :
+ * LZ4_count(), handing long matches over to LZ4_count_avx2() in the AVX2 kernel */
+LZ4_FORCE_INLINE unsigned LZ4_countMatch(const BYTE* pIn, const BYTE* pMatch, const BYTE* pInLimit,
+                                         const matchCount_directive matchCount)
+{
+#if LZ4_DISPATCH
+    if ((matchCount == count_avx2) && likely(pIn < pInLimit-(STEPSIZE-1))) {
+        reg_t const diff = LZ4_read_ARCH(pMatch) ^ LZ4_read_ARCH(pIn);
+        if (diff) return LZ4_NbCommonBytes(diff);
+        return STEPSIZE + LZ4_count_avx2(pIn+STEPSIZE, pMatch+STEPSIZE, pInLimit);
+    }
+#endif
+    (void)matchCount;
+    return LZ4_count(pIn, pMatch, pInLimit);
+}
+
 /** LZ4_compress_generic() :
     inlined, to ensure branches are decided at compilation time */
 LZ4_FORCE_INLINE int LZ4_compress_generic(
@@ -657,7 +923,9 @@ LZ4_FORCE_INLINE int LZ4_compress_generic(
                  const tableType_t tableType,
                  const dict_directive dictDirective,
                  const dictIssue_directive dictIssue,
-                 const U32 acceleration)
+                 const U32 acceleration,
+                 const U32 hashLog,
+                 const matchCount_directive matchCount)
 {
     const BYTE* ip = (const BYTE*) source;
 
@@ -666,6 +934,8 @@ LZ4_FORCE_INLINE int LZ4_compress_generic(
     const BYTE* lowLimit;
 
     const LZ4_stream_t_internal* dictCtx = (const LZ4_stream_t_internal*) cctx->dictCtx;
+    void* const hashTable = LZ4_hashTableOf(cctx, hashLog);
+    const void* const dictHashTable = (dictDirective == usingDictCtx) ? LZ4_constHashTableOf(dictCtx, hashLog) : NULL;
     const BYTE* const dictionary =
         dictDirective == usingDictCtx ? dictCtx->dictionary : cctx->dictionary;
     const U32 dictSize =
@@ -717,8 +987,8 @@ LZ4_FORCE_INLINE int LZ4_compress_generic(
     if (inputSize<LZ4_minLength) goto _last_literals;        /* Input too small, no compression (all literals) */
 
     /* First Byte */
-    LZ4_putPosition(ip, cctx->hashTable, tableType, base);
-    ip++; forwardH = LZ4_hashPosition(ip, tableType);
+    LZ4_putPosition(ip, hashTable, tableType, base, hashLog);
+    ip++; forwardH = LZ4_hashPosition(ip, tableType, hashLog);
 
     /* Main Loop */
     for ( ; ; ) {
@@ -739,9 +1009,9 @@ LZ4_FORCE_INLINE int LZ4_compress_generic(
                 if (unlikely(forwardIp > mflimitPlusOne)) goto _last_literals;
                 assert(ip < mflimitPlusOne);
 
-                match = LZ4_getPositionOnHash(h, cctx->hashTable, tableType, base);
-                forwardH = LZ4_hashPosition(forwardIp, tableType);
-                LZ4_putPositionOnHash(ip, h, cctx->hashTable, tableType, base);
+                match = LZ4_getPositionOnHash(h, hashTable, tableType, base);
+                forwardH = LZ4_hashPosition(forwardIp, tableType, hashLog);
+                LZ4_putPositionOnHash(ip, h, hashTable, tableType, base);
 
             } while ( (match+MAX_DISTANCE < ip)
                    || (LZ4_read32(match) != LZ4_read32(ip)) );
@@ -754,7 +1024,7 @@ LZ4_FORCE_INLINE int LZ4_compress_generic(
             do {
                 U32 const h = forwardH;
                 U32 const current = (U32)(forwardIp - base);
-                U32 matchIndex = LZ4_getIndexOnHash(h, cctx->hashTable, tableType);
+                U32 matchIndex = LZ4_getIndexOnHash(h, hashTable, tableType);
                 assert(matchIndex <= current);
                 assert(forwardIp - base < (ptrdiff_t)(2 GB - 1));
                 ip = forwardIp;
@@ -768,7 +1038,7 @@ LZ4_FORCE_INLINE int LZ4_compress_generic(
                     if (matchIndex < startIndex) {
                         /* there was no match, try the dictionary */
                         assert(tableType == byU32);
-                        matchIndex = LZ4_getIndexOnHash(h, dictCtx->hashTable, byU32);
+                        matchIndex = LZ4_getIndexOnHash(h, dictHashTable, byU32);
                         match = dictBase + matchIndex;
                         matchIndex += dictDelta;   /* make dictCtx index comparable with current context */
                         lowLimit = dictionary;
@@ -789,8 +1059,8 @@ LZ4_FORCE_INLINE int LZ4_compress_generic(
                 } else {   /* single continuous memory segment */
                     match = base + matchIndex;
                 }
-                forwardH = LZ4_hashPosition(forwardIp, tableType);
-                LZ4_putIndexOnHash(current, h, cctx->hashTable, tableType);
+                forwardH = LZ4_hashPosition(forwardIp, tableType, hashLog);
+                LZ4_putIndexOnHash(current, h, hashTable, tableType);
 
                 if ((dictIssue == dictSmall) && (matchIndex < prefixIdxLimit)) continue;    /* match outside of valid area */
                 assert(matchIndex < current);
@@ -869,16 +1139,16 @@ _next_match:
                 const BYTE* limit = ip + (dictEnd-match);
                 assert(dictEnd > match);
                 if (limit > matchlimit) limit = matchlimit;
-                matchCode = LZ4_count(ip+MINMATCH, match+MINMATCH, limit);
+                matchCode = LZ4_countMatch(ip+MINMATCH, match+MINMATCH, limit, matchCount);
                 ip += MINMATCH + matchCode;
                 if (ip==limit) {
-                    unsigned const more = LZ4_count(limit, (const BYTE*)source, matchlimit);
+                    unsigned const more = LZ4_countMatch(limit, (const BYTE*)source, matchlimit, matchCount);
                     matchCode += more;
                     ip += more;
                 }
                 DEBUGLOG(6, "             with matchLength=%u starting in extDict", matchCode+MINMATCH);
             } else {
-                matchCode = LZ4_count(ip+MINMATCH, match+MINMATCH, matchlimit);
+                matchCode = LZ4_countMatch(ip+MINMATCH, match+MINMATCH, matchlimit, matchCount);
                 ip += MINMATCH + matchCode;
                 DEBUGLOG(6, "             with matchLength=%u", matchCode+MINMATCH);
             }
@@ -915,27 +1185,27 @@ _next_match:
         if (ip >= mflimitPlusOne) break;
 
         /* Fill table */
-        LZ4_putPosition(ip-2, cctx->hashTable, tableType, base);
+        LZ4_putPosition(ip-2, hashTable, tableType, base, hashLog);
 
         /* Test next position */
         if (tableType == byPtr) {
 
-            match = LZ4_getPosition(ip, cctx->hashTable, tableType, base);
-            LZ4_putPosition(ip, cctx->hashTable, tableType, base);
+            match = LZ4_getPosition(ip, hashTable, tableType, base, hashLog);
+            LZ4_putPosition(ip, hashTable, tableType, base, hashLog);
             if ( (match+MAX_DISTANCE >= ip)
               && (LZ4_read32(match) == LZ4_read32(ip)) )
             { token=op++; *token=0; goto _next_match; }
 
         } else {   /* byU32, byU16 */
 
-            U32 const h = LZ4_hashPosition(ip, tableType);
+            U32 const h = LZ4_hashPosition(ip, tableType, hashLog);
             U32 const current = (U32)(ip-base);
-            U32 matchIndex = LZ4_getIndexOnHash(h, cctx->hashTable, tableType);
+            U32 matchIndex = LZ4_getIndexOnHash(h, hashTable, tableType);
             assert(matchIndex < current);
             if (dictDirective == usingDictCtx) {
                 if (matchIndex < startIndex) {
                     /* there was no match, try the dictionary */
-                    matchIndex = LZ4_getIndexOnHash(h, dictCtx->hashTable, byU32);
+                    matchIndex = LZ4_getIndexOnHash(h, dictHashTable, byU32);
                     match = dictBase + matchIndex;
                     lowLimit = dictionary;   /* required for match length counter */
                     matchIndex += dictDelta;
@@ -954,7 +1224,7 @@ _next_match:
             } else {   /* single memory segment */
                 match = base + matchIndex;
             }
-            LZ4_putIndexOnHash(current, h, cctx->hashTable, tableType);
+            LZ4_putIndexOnHash(current, h, hashTable, tableType);
             assert(matchIndex < current);
             if ( ((dictIssue==dictSmall) ? (matchIndex >= prefixIdxLimit) : 1)
               && ((tableType==byU16) ? 1 : (matchIndex+MAX_DISTANCE >= current))
@@ -969,7 +1239,7 @@ _next_match:
         }
 
         /* Prepare next loop */
-        forwardH = LZ4_hashPosition(++ip, tableType);
+        forwardH = LZ4_hashPosition(++ip, tableType, hashLog);
 
     }
 
@@ -1007,6 +1277,87 @@ _last_literals:
 }
 
 
+/** LZ4_compress_noDict() :
+ *  one-shot compression of an independent block, as run by the _extState() functions.
+ *  Compiled once per instruction set (see LZ4_DISPATCH). */
+LZ4_FORCE_INLINE int LZ4_compress_noDict(LZ4_stream_t_internal* cctx, const char* src, char* dst, int srcSize, int dstCapacity,
+                                         limitedOutput_directive outputLimited, tableType_t tableType,
+                                         dictIssue_directive dictIssue, int acceleration,
+                                         U32 hashLog, matchCount_directive matchCount)
+{
+    if (tableType == byU16) {
+        if (dictIssue == dictSmall) {
+            if (outputLimited == limitedOutput)
+                return LZ4_compress_generic(cctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, byU16, noDict, dictSmall, acceleration, hashLog, matchCount);
+            return LZ4_compress_generic(cctx, src, dst, srcSize, NULL, 0, notLimited, byU16, noDict, dictSmall, acceleration, hashLog, matchCount);
+        }
+        if (outputLimited == limitedOutput)
+            return LZ4_compress_generic(cctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, byU16, noDict, noDictIssue, acceleration, hashLog, matchCount);
+        return LZ4_compress_generic(cctx, src, dst, srcSize, NULL, 0, notLimited, byU16, noDict, noDictIssue, acceleration, hashLog, matchCount);
+    }
+    if ((sizeof(void*)==4) && (tableType == byPtr)) {   /* 32-bits only */
+        if (outputLimited == limitedOutput)
+            return LZ4_compress_generic(cctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, byPtr, noDict, noDictIssue, acceleration, hashLog, matchCount);
+        return LZ4_compress_generic(cctx, src, dst, srcSize, NULL, 0, notLimited, byPtr, noDict, noDictIssue, acceleration, hashLog, matchCount);
+    }
+    if (outputLimited == limitedOutput)
+        return LZ4_compress_generic(cctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, byU32, noDict, noDictIssue, acceleration, hashLog, matchCount);
+    return LZ4_compress_generic(cctx, src, dst, srcSize, NULL, 0, notLimited, byU32, noDict, noDictIssue, acceleration, hashLog, matchCount);
+}
+
+static int LZ4_compress_noDict_baseline(LZ4_stream_t_internal* cctx, const char* src, char* dst, int srcSize, int dstCapacity,
+                                        limitedOutput_directive outputLimited, tableType_t tableType,
+                                        dictIssue_directive dictIssue, int acceleration)
+{
+    return LZ4_compress_noDict(cctx, src, dst, srcSize, dstCapacity, outputLimited, tableType, dictIssue, acceleration, LZ4_HASHLOG, count_default);
+}
+
+#if LZ4_DISPATCH
+LZ4_TARGET_SSE41
+static int LZ4_compress_noDict_sse41(LZ4_stream_t_internal* cctx, const char* src, char* dst, int srcSize, int dstCapacity,
+                                     limitedOutput_directive outputLimited, tableType_t tableType,
+                                     dictIssue_directive dictIssue, int acceleration)
+{
+    return LZ4_compress_noDict(cctx, src, dst, srcSize, dstCapacity, outputLimited, tableType, dictIssue, acceleration, LZ4_HASHLOG, count_default);
+}
+
+LZ4_TARGET_AVX2
+static int LZ4_compress_noDict_avx2(LZ4_stream_t_internal* cctx, const char* src, char* dst, int srcSize, int dstCapacity,
+                                    limitedOutput_directive outputLimited, tableType_t tableType,
+                                    dictIssue_directive dictIssue, int acceleration)
+{
+    return LZ4_compress_noDict(cctx, src, dst, srcSize, dstCapacity, outputLimited, tableType, dictIssue, acceleration, LZ4_HASHLOG, count_avx2);
+}
+#endif
+
+/** LZ4_compress_hashLog() :
+ *  LZ4_compress_generic() on a stream set up by LZ4_initStreamHashLog(), whose table size is only known at runtime.
+ *  Default streams keep their instantiations on the constant LZ4_HASHLOG. */
+static int LZ4_compress_hashLog(LZ4_stream_t_internal* cctx, const char* src, char* dst, int srcSize, int dstCapacity,
+                                limitedOutput_directive outputLimited, tableType_t tableType,
+                                dict_directive dict, dictIssue_directive dictIssue, int acceleration)
+{
+    U32 const hashLog = cctx->hashLog;
+    assert(hashLog >= LZ4_HASHLOG_MIN && hashLog <= LZ4_HASHLOG_MAX);
+    switch (dict)
+    {
+    case withPrefix64k:
+        if (dictIssue == dictSmall)
+            return LZ4_compress_generic(cctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, byU32, withPrefix64k, dictSmall, acceleration, hashLog, count_default);
+        return LZ4_compress_generic(cctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, byU32, withPrefix64k, noDictIssue, acceleration, hashLog, count_default);
+    case usingExtDict:
+        if (dictIssue == dictSmall)
+            return LZ4_compress_generic(cctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, byU32, usingExtDict, dictSmall, acceleration, hashLog, count_default);
+        return LZ4_compress_generic(cctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, byU32, usingExtDict, noDictIssue, acceleration, hashLog, count_default);
+    case usingDictCtx:
+        return LZ4_compress_generic(cctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, byU32, usingDictCtx, noDictIssue, acceleration, hashLog, count_default);
+    case noDict:
+    default:
+        return LZ4_compress_noDict(cctx, src, dst, srcSize, dstCapacity, outputLimited, tableType, dictIssue, acceleration, hashLog, count_default);
+    }
+}
+
+
 int LZ4_compress_fast_extState(void* state, const char* source, char* dest, int inputSize, int maxOutputSize, int acceleration)
 {
     LZ4_stream_t_internal* ctx = &((LZ4_stream_t*)state)->internal_donotuse;
@@ -1014,17 +1365,17 @@ int LZ4_compress_fast_extState(void* state, const char* source, char* dest, int
     LZ4_resetStream((LZ4_stream_t*)state);
     if (maxOutputSize >= LZ4_compressBound(inputSize)) {
         if (inputSize < LZ4_64Klimit) {
-            return LZ4_compress_generic(ctx, source, dest, inputSize, NULL, 0, notLimited, byU16, noDict, noDictIssue, acceleration);
+            return LZ4_COMPRESS_NODICT(ctx, source, dest, inputSize, 0, notLimited, byU16, noDictIssue, acceleration);
         } else {
             const tableType_t tableType = ((sizeof(void*)==4) && ((uptrval)source > MAX_DISTANCE)) ? byPtr : byU32;
-            return LZ4_compress_generic(ctx, source, dest, inputSize, NULL, 0, notLimited, tableType, noDict, noDictIssue, acceleration);
+            return LZ4_COMPRESS_NODICT(ctx, source, dest, inputSize, 0, notLimited, tableType, noDictIssue, acceleration);
         }
     } else {
         if (inputSize < LZ4_64Klimit) {;
-            return LZ4_compress_generic(ctx, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, byU16, noDict, noDictIssue, acceleration);
+            return LZ4_COMPRESS_NODICT(ctx, source, dest, inputSize, maxOutputSize, limitedOutput, byU16, noDictIssue, acceleration);
         } else {
             const tableType_t tableType = ((sizeof(void*)==4) && ((uptrval)source > MAX_DISTANCE)) ? byPtr : byU32;
-            return LZ4_compress_generic(ctx, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, tableType, noDict, noDictIssue, acceleration);
+            return LZ4_COMPRESS_NODICT(ctx, source, dest, inputSize, maxOutputSize, limitedOutput, tableType, noDictIssue, acceleration);
         }
     }
 }
@@ -1041,37 +1392,18 @@ int LZ4_compress_fast_extState(void* state, const char* source, char* dest, int
 int LZ4_compress_fast_extState_fastReset(void* state, const char* src, char* dst, int srcSize, int dstCapacity, int acceleration)
 {
     LZ4_stream_t_internal* ctx = &((LZ4_stream_t*)state)->internal_donotuse;
+    limitedOutput_directive const outputLimited = (dstCapacity >= LZ4_compressBound(srcSize)) ? notLimited : limitedOutput;
+    tableType_t const tableType = (srcSize < LZ4_64Klimit) ? byU16
+                                : ((sizeof(void*)==4) && ((uptrval)src > MAX_DISTANCE)) ? byPtr : byU32;
+    dictIssue_directive dictIssue;
     if (acceleration < 1) acceleration = ACCELERATION_DEFAULT;
 
-    if (dstCapacity >= LZ4_compressBound(srcSize)) {
-        if (srcSize < LZ4_64Klimit) {
-            const tableType_t tableType = byU16;
-            LZ4_prepareTable(ctx, srcSize, tableType);
-            if (ctx->currentOffset) {
-                return LZ4_compress_generic(ctx, src, dst, srcSize, NULL, 0, notLimited, tableType, noDict, dictSmall, acceleration);
-            } else {
-                return LZ4_compress_generic(ctx, src, dst, srcSize, NULL, 0, notLimited, tableType, noDict, noDictIssue, acceleration);
-            }
-        } else {
-            const tableType_t tableType = ((sizeof(void*)==4) && ((uptrval)src > MAX_DISTANCE)) ? byPtr : byU32;
-            LZ4_prepareTable(ctx, srcSize, tableType);
-            return LZ4_compress_generic(ctx, src, dst, srcSize, NULL, 0, notLimited, tableType, noDict, noDictIssue, acceleration);
-        }
-    } else {
-        if (srcSize < LZ4_64Klimit) {
-            const tableType_t tableType = byU16;
-            LZ4_prepareTable(ctx, srcSize, tableType);
-            if (ctx->currentOffset) {
-                return LZ4_compress_generic(ctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, tableType, noDict, dictSmall, acceleration);
-            } else {
-                return LZ4_compress_generic(ctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, tableType, noDict, noDictIssue, acceleration);
-            }
-        } else {
-            const tableType_t tableType = ((sizeof(void*)==4) && ((uptrval)src > MAX_DISTANCE)) ? byPtr : byU32;
-            LZ4_prepareTable(ctx, srcSize, tableType);
-            return LZ4_compress_generic(ctx, src, dst, srcSize, NULL, dstCapacity, limitedOutput, tableType, noDict, noDictIssue, acceleration);
-        }
-    }
+    LZ4_prepareTable(ctx, srcSize, tableType);
+    dictIssue = ((tableType == byU16) && ctx->currentOffset) ? dictSmall : noDictIssue;
+    if (outputLimited == notLimited) dstCapacity = 0;
+    if (ctx->hashLog)
+        return LZ4_compress_hashLog(ctx, src, dst, srcSize, dstCapacity, outputLimited, tableType, noDict, dictIssue, acceleration);
+    return LZ4_COMPRESS_NODICT(ctx, src, dst, srcSize, dstCapacity, outputLimited, tableType, dictIssue, acceleration);
 }
 
 
@@ -1108,9 +1440,9 @@ int LZ4_compress_fast_force(const char* source, char* dest, int inputSize, int m
     LZ4_resetStream(&ctx);
 
     if (inputSize < LZ4_64Klimit)
-        return LZ4_compress_generic(&ctx.internal_donotuse, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, byU16,                        noDict, noDictIssue, acceleration);
+        return LZ4_compress_generic(&ctx.internal_donotuse, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, byU16,                        noDict, noDictIssue, acceleration, LZ4_HASHLOG, count_default);
     else
-        return LZ4_compress_generic(&ctx.internal_donotuse, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, sizeof(void*)==8 ? byU32 : byPtr, noDict, noDictIssue, acceleration);
+        return LZ4_compress_generic(&ctx.internal_donotuse, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, sizeof(void*)==8 ? byU32 : byPtr, noDict, noDictIssue, acceleration, LZ4_HASHLOG, count_default);
 }
 
 
@@ -1125,10 +1457,10 @@ static int LZ4_compress_destSize_extState (LZ4_stream_t* state, const char* src,
         return LZ4_compress_fast_extState(state, src, dst, *srcSizePtr, targetDstSize, 1);
     } else {
         if (*srcSizePtr < LZ4_64Klimit) {
-            return LZ4_compress_generic(&state->internal_donotuse, src, dst, *srcSizePtr, srcSizePtr, targetDstSize, fillOutput, byU16, noDict, noDictIssue, 1);
+            return LZ4_compress_generic(&state->internal_donotuse, src, dst, *srcSizePtr, srcSizePtr, targetDstSize, fillOutput, byU16, noDict, noDictIssue, 1, LZ4_HASHLOG, count_default);
         } else {
             tableType_t const tableType = ((sizeof(void*)==4) && ((uptrval)src > MAX_DISTANCE)) ? byPtr : byU32;
-            return LZ4_compress_generic(&state->internal_donotuse, src, dst, *srcSizePtr, srcSizePtr, targetDstSize, fillOutput, tableType, noDict, noDictIssue, 1);
+            return LZ4_compress_generic(&state->internal_donotuse, src, dst, *srcSizePtr, srcSizePtr, targetDstSize, fillOutput, tableType, noDict, noDictIssue, 1, LZ4_HASHLOG, count_default);
     }   }
 }
 
@@ -1152,6 +1484,66 @@ int LZ4_compress_destSize(const char* src, char* dst, int* srcSizePtr, int targe
 }
 
 
+/* LZ4_isCompressible() samples LZ4_SAMPLE_WINDOWS windows of LZ4_SAMPLE_WINDOW bytes,
+ * spread over the input (all of it when it is smaller) */
+#define LZ4_SAMPLE_WINDOW   256
+#define LZ4_SAMPLE_WINDOWS  8
+#define LZ4_SAMPLE_HASHLOG  10
+
+int LZ4_isCompressible(const char* src, int srcSize)
+{
+    U32 table[1 << LZ4_SAMPLE_HASHLOG];   /* last sampled position with this hash; 0 at first, which is a valid candidate too */
+    U32 histogram[256];
+    const BYTE* const istart = (const BYTE*)src;
+    int const nbWindows = (srcSize > LZ4_SAMPLE_WINDOW * LZ4_SAMPLE_WINDOWS) ? LZ4_SAMPLE_WINDOWS : 1;
+    int const windowSize = (nbWindows > 1) ? LZ4_SAMPLE_WINDOW : srcSize;
+    size_t windowStart[LZ4_SAMPLE_WINDOWS];
+    U64 const sampled = (U64)nbWindows * (U64)windowSize;
+    U64 saved = 0, pairs = 0;
+    int w, i;
+
+    if (srcSize < MFLIMIT) return 0;   /* too small to hold a match */
+    for (w=0; w<nbWindows; w++)
+        windowStart[w] = (nbWindows > 1) ? (size_t)((U64)(srcSize - windowSize) * (U64)w / (U64)(nbWindows-1)) : 0;
+
+    /* the byte distribution tells apart data LZ4 may compress over larger distances than the samples (text, ...)
+     * from entropy-coded data (image, audio and archive formats ...), whose collision entropy, -log2(sum(p*p)),
+     * is close to 8 bits per byte : below 7.5 bits, compression is worth trying */
+    MEM_INIT(histogram, 0, sizeof(histogram));
+    for (w=0; w<nbWindows; w++) {
+        const BYTE* const wstart = istart + windowStart[w];
+        for (i=0; i<windowSize; i++) histogram[wstart[i]]++;
+    }
+    for (i=0; i<256; i++) pairs += (U64)histogram[i] * (histogram[i] - (histogram[i] > 0));
+    if (pairs * 181 > sampled * (sampled-1)) return 1;
+
+    /* near-random bytes : only repeated sequences can still be compressed.
+     * Greedy matches within the samples, each saving its length minus about 3 bytes (token and offset) */
+    MEM_INIT(table, 0, sizeof(table));
+    for (w=0; w<nbWindows; w++) {
+        const BYTE* ip = istart + windowStart[w];
+        const BYTE* const wend = ip + windowSize;
+        while (ip <= wend - MINMATCH) {
+            U32 const sequence = LZ4_read32(ip);
+            U32 const h = (sequence * 2654435761U) >> ((MINMATCH*8)-LZ4_SAMPLE_HASHLOG);
+            U32 const pos = (U32)(ip - istart);
+            U32 const ref = table[h];
+            table[h] = pos;
+            if ((LZ4_read32(istart + ref) == sequence) && (ref < pos) && (pos - ref <= MAX_DISTANCE)) {
+                const BYTE* const match = istart + ref;
+                size_t length = MINMATCH;
+                while ((ip + length < wend) && (ip[length] == match[length])) length++;
+                saved += length - 3;
+                ip += length;
+                continue;
+            }
+            ip++;
+    }   }
+
+    return (saved * 64 >= sampled);   /* saves at least 1/64 of the samples */
+}
+
+
 
 /*-******************************
 *  Streaming functions
@@ -1185,6 +1577,61 @@ int LZ4_freeStream (LZ4_stream_t* LZ4_stream)
     return (0);
 }
 
+/* LZ4_clearStream() :
+ * full reset, keeping the table size set by LZ4_initStreamHashLog().
+ * Only the part of the table in use is cleared. */
+static void LZ4_clearStream(LZ4_stream_t* LZ4_stream)
+{
+    LZ4_stream_t_internal* const cctx = &LZ4_stream->internal_donotuse;
+    U32 const hashLog = cctx->hashLog;
+    if (hashLog == 0) {
+        LZ4_resetStream(LZ4_stream);
+        return;
+    }
+    MEM_INIT(LZ4_hashTableOf(cctx, hashLog), 0, (size_t)4 << hashLog);
+    cctx->currentOffset = 0;
+    cctx->initCheck = 0;
+    cctx->tableType = clearedTable;
+    cctx->dictionary = NULL;
+    cctx->dictCtx = NULL;
+    cctx->dictSize = 0;
+}
+
+int LZ4_sizeofStateHashLog(int hashLog)
+{
+    if ((hashLog < LZ4_HASHLOG_MIN) || (hashLog > LZ4_HASHLOG_MAX)) return 0;
+    return (int)LZ4_STREAMSIZE_HASHLOG(hashLog);
+}
+
+LZ4_stream_t* LZ4_initStreamHashLog(void* buffer, size_t size, int hashLog)
+{
+    LZ4_stream_t* const lz4s = (LZ4_stream_t*)buffer;
+    int const stateSize = LZ4_sizeofStateHashLog(hashLog);
+    DEBUGLOG(4, "LZ4_initStreamHashLog %p (hashLog:%i)", buffer, hashLog);
+    if ((buffer == NULL) || (stateSize == 0) || (size < (size_t)stateSize)) return NULL;
+    if (((size_t)buffer) & (sizeof(unsigned long long)-1)) return NULL;   /* must be aligned like LZ4_stream_t */
+    lz4s->internal_donotuse.hashLog = (hashLog == LZ4_HASHLOG) ? 0 : (U32)hashLog;
+    LZ4_clearStream(lz4s);
+    return lz4s;
+}
+
+LZ4_stream_t* LZ4_createStreamHashLog(int hashLog)
+{
+    int const stateSize = LZ4_sizeofStateHashLog(hashLog);
+    LZ4_stream_t* lz4s;
+    if (stateSize == 0) return NULL;
+    lz4s = (LZ4_stream_t*)ALLOC((size_t)stateSize);   /* malloc-calloc always properly aligned */
+    if (lz4s == NULL) return NULL;
+    return LZ4_initStreamHashLog(lz4s, (size_t)stateSize, hashLog);
+}
+
+int LZ4_compress_fast_extStateHashLog(void* state, const char* src, char* dst, int srcSize, int dstCapacity, int acceleration, int hashLog)
+{
+    int const stateSize = LZ4_sizeofStateHashLog(hashLog);
+    if (LZ4_initStreamHashLog(state, (size_t)stateSize, hashLog) == NULL) return 0;
+    return LZ4_compress_fast_extState_fastReset(state, src, dst, srcSize, dstCapacity, acceleration);
+}
+
 
 #define HASH_UNIT sizeof(reg_t)
 int LZ4_loadDict (LZ4_stream_t* LZ4_dict, const char* dictionary, int dictSize)
@@ -1201,7 +1648,7 @@ int LZ4_loadDict (LZ4_stream_t* LZ4_dict, const char* dictionary, int dictSize)
      * and not just continue it with prepareTable()
      * to avoid any risk of generating overflowing matchIndex
      * when compressing using this dictionary */
-    LZ4_resetStream(LZ4_dict);
+    LZ4_clearStream(LZ4_dict);
 
     /* We always increment the offset by 64 KB, since, if the dict is longer,
      * we truncate it to the last 64k, and if it's shorter, we still want to
@@ -1221,16 +1668,19 @@ int LZ4_loadDict (LZ4_stream_t* LZ4_dict, const char* dictionary, int dictSize)
         return 0;
     }
 
-    while (p <= dictEnd-HASH_UNIT) {
-        LZ4_putPosition(p, dict->hashTable, tableType, base);
-        p+=3;
-    }
+    {   U32 const hashLog = LZ4_streamHashLog(dict);
+        void* const hashTable = LZ4_hashTableOf(dict, hashLog);
+        while (p <= dictEnd-HASH_UNIT) {
+            LZ4_putPosition(p, hashTable, tableType, base, hashLog);
+            p+=3;
+    }   }
 
     return dict->dictSize;
 }
 
 void LZ4_attach_dictionary(LZ4_stream_t *working_stream, const LZ4_stream_t *dictionary_stream) {
-    if (dictionary_stream != NULL) {
+    if ( (dictionary_stream != NULL)
+      && (dictionary_stream->internal_donotuse.hashLog == working_stream->internal_donotuse.hashLog) ) {   /* tables are read with the working stream's hash */
         /* If the current offset is zero, we will never look in the
          * external dictionary context, since there is no value a table
          * entry can take that indicate a miss. In that case, we need
@@ -1245,6 +1695,48 @@ void LZ4_attach_dictionary(LZ4_stream_t *working_stream, const LZ4_stream_t *dic
     }
 }
 
+size_t LZ4_sizeofDictBlob(const LZ4_stream_t* dictStream)
+{
+    const LZ4_stream_t_internal* const dict = &dictStream->internal_donotuse;
+    return LZ4_DICTBLOB_HEADERSIZE + LZ4_STREAMSIZE_HASHLOG(dict->hashLog) + dict->dictSize;
+}
+
+size_t LZ4_saveDictBlob(const LZ4_stream_t* dictStream, void* blob, size_t blobCapacity)
+{
+    const LZ4_stream_t_internal* const dict = &dictStream->internal_donotuse;
+    size_t const stateSize = LZ4_STREAMSIZE_HASHLOG(dict->hashLog);
+    LZ4_stream_t* const state = (LZ4_stream_t*)((BYTE*)blob + LZ4_DICTBLOB_HEADERSIZE);
+
+    if ((dict->tableType != (U16)byU32) || (dict->dictCtx != NULL)) return 0;   /* not primed by LZ4_loadDict() */
+    if (((uptrval)blob & 7) != 0) return 0;
+    if (blobCapacity < LZ4_sizeofDictBlob(dictStream)) return 0;
+
+    LZ4_writeDictBlobHeader(blob, LZ4_DICTBLOB_STREAM, stateSize, dict->dictSize, 0, 0, 0);
+    memcpy(state, dictStream, stateSize);
+    state->internal_donotuse.dictionary = NULL;
+    if (dict->dictSize) memcpy((BYTE*)state + stateSize, dict->dictionary, dict->dictSize);
+    return LZ4_sizeofDictBlob(dictStream);
+}
+
+const LZ4_stream_t* LZ4_loadDictBlob(void* blob, size_t blobSize)
+{
+    LZ4_dictBlobHeader_t header;
+    LZ4_stream_t* const state = (LZ4_stream_t*)((BYTE*)blob + LZ4_DICTBLOB_HEADERSIZE);
+    U32 hashLog;
+
+    if (!LZ4_readDictBlobHeader(&header, blob, blobSize, LZ4_DICTBLOB_STREAM)) return NULL;
+    if (header.stateSize < sizeof(LZ4_stream_t)) return NULL;
+    hashLog = state->internal_donotuse.hashLog;
+    if ((hashLog != 0) && ((hashLog < LZ4_HASHLOG_MIN) || (hashLog > LZ4_HASHLOG_MAX))) return NULL;
+    if (header.stateSize != LZ4_STREAMSIZE_HASHLOG(hashLog)) return NULL;   /* also another LZ4_MEMORY_USAGE */
+    if ( (state->internal_donotuse.tableType != (U16)byU32)
+      || (state->internal_donotuse.dictSize != header.dictSize) ) return NULL;
+
+    state->internal_donotuse.dictionary = (const BYTE*)state + header.stateSize;
+    state->internal_donotuse.dictCtx = NULL;
+    return state;
+}
+
 
 static void LZ4_renormDictT(LZ4_stream_t_internal* LZ4_dict, int nextSize)
 {
@@ -1252,11 +1744,13 @@ static void LZ4_renormDictT(LZ4_stream_t_internal* LZ4_dict, int nextSize)
         /* rescale hash table */
         U32 const delta = LZ4_dict->currentOffset - 64 KB;
         const BYTE* dictEnd = LZ4_dict->dictionary + LZ4_dict->dictSize;
+        U32 const hashLog = LZ4_streamHashLog(LZ4_dict);
+        U32* const hashTable = (U32*)LZ4_hashTableOf(LZ4_dict, hashLog);
         int i;
         DEBUGLOG(4, "LZ4_renormDictT");
-        for (i=0; i<LZ4_HASH_SIZE_U32; i++) {
-            if (LZ4_dict->hashTable[i] < delta) LZ4_dict->hashTable[i]=0;
-            else LZ4_dict->hashTable[i] -= delta;
+        for (i=0; i<(1 << hashLog); i++) {
+            if (hashTable[i] < delta) hashTable[i]=0;
+            else hashTable[i] -= delta;
         }
         LZ4_dict->currentOffset = 64 KB;
         if (LZ4_dict->dictSize > 64 KB) LZ4_dict->dictSize = 64 KB;
@@ -1265,9 +1759,18 @@ static void LZ4_renormDictT(LZ4_stream_t_internal* LZ4_dict, int nextSize)
 }
 
 
+/* one block of LZ4_compress_fast_continue(), on the stream's table size */
+LZ4_FORCE_INLINE int LZ4_compress_continue_block(LZ4_stream_t_internal* streamPtr, const char* source, char* dest,
+                                                 int inputSize, int maxOutputSize,
+                                                 dict_directive dict, dictIssue_directive dictIssue, int acceleration)
+{
+    if (streamPtr->hashLog)
+        return LZ4_compress_hashLog(streamPtr, source, dest, inputSize, maxOutputSize, limitedOutput, byU32, dict, dictIssue, acceleration);
+    return LZ4_compress_generic(streamPtr, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, byU32, dict, dictIssue, acceleration, LZ4_HASHLOG, count_default);
+}
+
 int LZ4_compress_fast_continue (LZ4_stream_t* LZ4_stream, const char* source, char* dest, int inputSize, int maxOutputSize, int acceleration)
 {
-    const tableType_t tableType = byU32;
     LZ4_stream_t_internal* streamPtr = &LZ4_stream->internal_donotuse;
     const BYTE* dictEnd = streamPtr->dictionary + streamPtr->dictSize;
 
@@ -1299,9 +1802,9 @@ int LZ4_compress_fast_continue (LZ4_stream_t* LZ4_stream, const char* source, ch
     /* prefix mode : source data follows dictionary */
     if (dictEnd == (const BYTE*)source) {
         if ((streamPtr->dictSize < 64 KB) && (streamPtr->dictSize < streamPtr->currentOffset))
-            return LZ4_compress_generic(streamPtr, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, tableType, withPrefix64k, dictSmall, acceleration);
+            return LZ4_compress_continue_block(streamPtr, source, dest, inputSize, maxOutputSize, withPrefix64k, dictSmall, acceleration);
         else
-            return LZ4_compress_generic(streamPtr, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, tableType, withPrefix64k, noDictIssue, acceleration);
+            return LZ4_compress_continue_block(streamPtr, source, dest, inputSize, maxOutputSize, withPrefix64k, noDictIssue, acceleration);
     }
 
     /* external dictionary mode */
@@ -1318,16 +1821,19 @@ int LZ4_compress_fast_continue (LZ4_stream_t* LZ4_stream, const char* source, ch
                  * cost to copy the dictionary's tables into the active context,
                  * so that the compression loop is only looking into one table.
                  */
-                memcpy(streamPtr, streamPtr->dictCtx, sizeof(LZ4_stream_t));
-                result = LZ4_compress_generic(streamPtr, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, tableType, usingExtDict, noDictIssue, acceleration);
+                const LZ4_stream_t_internal* const dictCtx = streamPtr->dictCtx;
+                memcpy(streamPtr, dictCtx, sizeof(LZ4_stream_t));
+                if (dictCtx->hashLog > LZ4_HASHLOG)
+                    memcpy(LZ4_hashTableOf(streamPtr, dictCtx->hashLog), LZ4_constHashTableOf(dictCtx, dictCtx->hashLog), (size_t)4 << dictCtx->hashLog);
+                result = LZ4_compress_continue_block(streamPtr, source, dest, inputSize, maxOutputSize, usingExtDict, noDictIssue, acceleration);
             } else {
-                result = LZ4_compress_generic(streamPtr, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, tableType, usingDictCtx, noDictIssue, acceleration);
+                result = LZ4_compress_continue_block(streamPtr, source, dest, inputSize, maxOutputSize, usingDictCtx, noDictIssue, acceleration);
             }
         } else {
             if ((streamPtr->dictSize < 64 KB) && (streamPtr->dictSize < streamPtr->currentOffset)) {
-                result = LZ4_compress_generic(streamPtr, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, tableType, usingExtDict, dictSmall, acceleration);
+                result = LZ4_compress_continue_block(streamPtr, source, dest, inputSize, maxOutputSize, usingExtDict, dictSmall, acceleration);
             } else {
-                result = LZ4_compress_generic(streamPtr, source, dest, inputSize, NULL, maxOutputSize, limitedOutput, tableType, usingExtDict, noDictIssue, acceleration);
+                result = LZ4_compress_continue_block(streamPtr, source, dest, inputSize, maxOutputSize, usingExtDict, noDictIssue, acceleration);
             }
         }
         streamPtr->dictionary = (const BYTE*)source;
@@ -1346,9 +1852,9 @@ int LZ4_compress_forceExtDict (LZ4_stream_t* LZ4_dict, const char* source, char*
     LZ4_renormDictT(streamPtr, srcSize);
 
     if ((streamPtr->dictSize < 64 KB) && (streamPtr->dictSize < streamPtr->currentOffset)) {
-        result = LZ4_compress_generic(streamPtr, source, dest, srcSize, NULL, 0, notLimited, byU32, usingExtDict, dictSmall, 1);
+        result = LZ4_compress_generic(streamPtr, source, dest, srcSize, NULL, 0, notLimited, byU32, usingExtDict, dictSmall, 1, LZ4_HASHLOG, count_default);
     } else {
-        result = LZ4_compress_generic(streamPtr, source, dest, srcSize, NULL, 0, notLimited, byU32, usingExtDict, noDictIssue, 1);
+        result = LZ4_compress_generic(streamPtr, source, dest, srcSize, NULL, 0, notLimited, byU32, usingExtDict, noDictIssue, 1, LZ4_HASHLOG, count_default);
     }
 
     streamPtr->dictionary = (const BYTE*)source;
@@ -1393,6 +1899,24 @@ typedef enum { decode_full_block = 0, partial_decode = 1 } earlyEnd_directive;
 #undef MIN
 #define MIN(a,b)    ( (a) < (b) ? (a) : (b) )
 
+#if LZ4_FAST_DEC_LOOP
+/* the fast loop runs while output and input are at least this far from their ends */
+#define FASTLOOP_SAFE_DISTANCE 64
+
+/* variant of LZ4_wildCopy() copying 16 bytes per step, which can overwrite up to 16 bytes beyond dstEnd.
+ * Steps stay at 16 bytes so that literal copies never overlap the input when decoding in-place
+ * (see LZ4_DECOMPRESS_INPLACE_MARGIN()). */
+LZ4_FORCE_O2_INLINE_GCC_PPC64LE
+void LZ4_wildCopy16(void* dstPtr, const void* srcPtr, void* dstEnd)
+{
+    BYTE* d = (BYTE*)dstPtr;
+    const BYTE* s = (const BYTE*)srcPtr;
+    BYTE* const e = (BYTE*)dstEnd;
+
+    do { memcpy(d,s,16); d+=16; s+=16; } while (d<e);
+}
+#endif
+
 /*! LZ4_decompress_generic() :
  *  This generic decompression function covers all use cases.
  *  It shall be instantiated several times, using different sets of directives.
@@ -1421,6 +1945,11 @@ LZ4_decompress_generic(
     BYTE* const oend = op + outputSize;
     BYTE* cpy;
 
+    const BYTE* match;
+    size_t offset;
+    unsigned token;
+    size_t length;
+
     const BYTE* const dictEnd = (const BYTE*)dictStart + dictSize;
     const unsigned inc32table[8] = {0, 1, 2,  1,  0,  4, 4, 4};
     const int      dec64table[8] = {0, 0, 0, -1, -4,  1, 2, 3};
@@ -1441,13 +1970,117 @@ LZ4_decompress_generic(
     if ((!endOnInput) && (unlikely(outputSize==0))) return (*ip==0 ? 1 : -1);
     if ((endOnInput) && unlikely(srcSize==0)) return -1;
 
+#if LZ4_FAST_DEC_LOOP
+    /* Fast loop : decode sequences while both buffers have at least FASTLOOP_SAFE_DISTANCE bytes left,
+     * so that literals and matches can be copied 16 bytes at a time without checking their ends.
+     * The first sequence which doesn't fit hands over to the careful loop below. */
+    if ((endOnInput) && (outputSize >= FASTLOOP_SAFE_DISTANCE) && (srcSize >= FASTLOOP_SAFE_DISTANCE)) {
+        BYTE* const oendFast = oend - FASTLOOP_SAFE_DISTANCE;
+        const BYTE* const iendFast = iend - FASTLOOP_SAFE_DISTANCE;
+
+        while ((op < oendFast) & (ip < iendFast)) {
+            token = *ip++;
+            length = token >> ML_BITS;  /* literal length */
+
+            /* copy literals */
+            if (length == RUN_MASK) {
+                unsigned s;
+                do {
+                    s = *ip++;
+                    length += s;
+                } while ( likely(ip<iend-RUN_MASK) & (s==255) );
+                if ((safeDecode) && unlikely((uptrval)(op)+length<(uptrval)(op))) goto _output_error;   /* overflow detection */
+                if ((safeDecode) && unlikely((uptrval)(ip)+length<(uptrval)(ip))) goto _output_error;   /* overflow detection */
+                cpy = op+length;
+                if ((cpy > oendFast) || (ip+length > iendFast)) goto _safe_literal_copy;
+                LZ4_wildCopy16(op, ip, cpy);
+            } else {
+                /* 0..14 literals : one unconditional copy, ip is at least FASTLOOP_SAFE_DISTANCE from iend */
+                cpy = op+length;
+                memcpy(op, ip, 16);
+            }
+            ip += length; op = cpy;
+
+            /* get offset */
+            offset = LZ4_readLE16(ip); ip+=2;
+            match = op - offset;
+
+            /* get matchlength */
+            length = token & ML_MASK;
+            if (length == ML_MASK) {
+                unsigned s;
+                do {
+                    s = *ip++;
+                    if (ip > iend-LASTLITERALS) goto _output_error;
+                    length += s;
+                } while (s==255);
+                if ((safeDecode) && unlikely((uptrval)(op)+length<(uptrval)op)) goto _output_error;   /* overflow detection */
+            } else if ( (offset >= 8)
+                     && (dict==withPrefix64k || match >= lowPrefix) ) {
+                /* 4..18 bytes match : copy 18 bytes, op is at least FASTLOOP_SAFE_DISTANCE from oend */
+                memcpy(op + 0, match + 0, 8);
+                memcpy(op + 8, match + 8, 8);
+                memcpy(op +16, match +16, 2);
+                op += length + MINMATCH;
+                continue;
+            }
+            length += MINMATCH;
+
+            if ((checkOffset) && (unlikely(match + dictSize < lowPrefix))) goto _output_error;   /* Error : offset outside buffers */
+            if (op + length > oendFast) goto _safe_match_copy;
+
+            /* match starting within external dictionary */
+            if ((dict==usingExtDict) && (match < lowPrefix)) {
+                if (length <= (size_t)(lowPrefix-match)) {
+                    /* match fits entirely within external dictionary : just copy */
+                    memmove(op, dictEnd - (lowPrefix-match), length);
+                    op += length;
+                } else {
+                    /* match stretches into both external dictionary and current block */
+                    size_t const copySize = (size_t)(lowPrefix - match);
+                    size_t const restSize = length - copySize;
+                    memcpy(op, dictEnd - copySize, copySize);
+                    op += copySize;
+                    if (restSize > (size_t)(op - lowPrefix)) {  /* overlap copy */
+                        BYTE* const endOfMatch = op + restSize;
+                        const BYTE* copyFrom = lowPrefix;
+                        while (op < endOfMatch) *op++ = *copyFrom++;
+                    } else {
+                        memcpy(op, lowPrefix, restSize);
+                        op += restSize;
+                }   }
+                continue;
+            }
+
+            /* copy match within block */
+            cpy = op + length;
+            if (unlikely(offset<16)) {
+                if (offset<8) {
+                    LZ4_write32(op, 0);   /* silence an msan warning when offset==0 */
+                    op[0] = match[0];
+                    op[1] = match[1];
+                    op[2] = match[2];
+                    op[3] = match[3];
+                    match += inc32table[offset];
+                    memcpy(op+4, match, 4);
+                    match -= dec64table[offset];
+                } else {
+                    memcpy(op, match, 8);
+                    match += 8;
+                }
+                LZ4_wildCopy(op+8, match, cpy);
+            } else {
+                LZ4_wildCopy16(op, match, cpy);
+            }
+            op = cpy;   /* wildcopy correction */
+        }
+    }
+#endif
+
     /* Main Loop : decode sequences */
     while (1) {
-        const BYTE* match;
-        size_t offset;
-
-        unsigned const token = *ip++;
-        size_t length = token >> ML_BITS;  /* literal length */
+        token = *ip++;
+        length = token >> ML_BITS;  /* literal length */
 
         assert(!endOnInput || ip <= iend); /* ip < iend before the increment */
 
@@ -1506,6 +2139,9 @@ LZ4_decompress_generic(
 
         /* copy literals */
         cpy = op+length;
+#if LZ4_FAST_DEC_LOOP
+_safe_literal_copy:
+#endif
         LZ4_STATIC_ASSERT(MFLIMIT >= WILDCOPYLENGTH);
         if ( ((endOnInput) && ((cpy>oend-MFLIMIT) || (ip+length>iend-(2+1+LASTLITERALS))) )
           || ((!endOnInput) && (cpy>oend-WILDCOPYLENGTH)) )
@@ -1517,7 +2153,7 @@ LZ4_decompress_generic(
                 if ((!endOnInput) && (cpy != oend)) goto _output_error;       /* Error : block decoding must stop exactly there */
                 if ((endOnInput) && ((ip+length != iend) || (cpy > oend))) goto _output_error;   /* Error : input must be consumed */
             }
-            memcpy(op, ip, length);
+            memmove(op, ip, length);  /* supports overlapping memory regions, for in-place decompression */
             ip += length;
             op += length;
             if (!partialDecoding || (cpy == oend)) {
@@ -1556,6 +2192,9 @@ _copy_match:
         }
         length += MINMATCH;
 
+#if LZ4_FAST_DEC_LOOP
+_safe_match_copy:
+#endif
         /* match starting within external dictionary */
         if ((dict==usingExtDict) && (match < lowPrefix)) {
             if (unlikely(op+length > oend-LASTLITERALS)) {
@@ -1645,14 +2284,134 @@ _output_error:
 }
 
 
+/** LZ4_decompress_safe_kernel() :
+ *  full-block safe decoding, with any kind of dictionary, as run by the LZ4_decompress_safe*() functions.
+ *  Compiled once per instruction set (see LZ4_DISPATCH). */
+LZ4_FORCE_INLINE int
+LZ4_decompress_safe_kernel(const char* src, char* dst, int srcSize, int dstCapacity,
+                           dict_directive dict, const BYTE* lowPrefix, const BYTE* dictStart, size_t dictSize)
+{
+    if (dict == withPrefix64k)
+        return LZ4_decompress_generic(src, dst, srcSize, dstCapacity,
+                                      endOnInputSize, decode_full_block, withPrefix64k,
+                                      lowPrefix, NULL, 0);
+    if (dict == usingExtDict)
+        return LZ4_decompress_generic(src, dst, srcSize, dstCapacity,
+                                      endOnInputSize, decode_full_block, usingExtDict,
+                                      lowPrefix, dictStart, dictSize);
+    return LZ4_decompress_generic(src, dst, srcSize, dstCapacity,
+                                  endOnInputSize, decode_full_block, noDict,
+                                  lowPrefix, NULL, 0);
+}
+
+LZ4_FORCE_O2_GCC_PPC64LE
+static int LZ4_decompress_safe_baseline(const char* src, char* dst, int srcSize, int dstCapacity,
+                                        dict_directive dict, const BYTE* lowPrefix, const BYTE* dictStart, size_t dictSize)
+{
+    return LZ4_decompress_safe_kernel(src, dst, srcSize, dstCapacity, dict, lowPrefix, dictStart, dictSize);
+}
+
+#if LZ4_DISPATCH
+LZ4_TARGET_SSE41
+static int LZ4_decompress_safe_sse41(const char* src, char* dst, int srcSize, int dstCapacity,
+                                     dict_directive dict, const BYTE* lowPrefix, const BYTE* dictStart, size_t dictSize)
+{
+    return LZ4_decompress_safe_kernel(src, dst, srcSize, dstCapacity, dict, lowPrefix, dictStart, dictSize);
+}
+
+LZ4_TARGET_AVX2
+static int LZ4_decompress_safe_avx2(const char* src, char* dst, int srcSize, int dstCapacity,
+                                    dict_directive dict, const BYTE* lowPrefix, const BYTE* dictStart, size_t dictSize)
+{
+    return LZ4_decompress_safe_kernel(src, dst, srcSize, dstCapacity, dict, lowPrefix, dictStart, dictSize);
+}
+#endif
+
+
+/*-*******************************
+ *  CPU dispatch
+ ********************************/
+#if LZ4_DISPATCH
+
+static const LZ4_kernels_t LZ4_kernelTable[LZ4_cpu_count] = {
+    { LZ4_compress_noDict_baseline, LZ4_decompress_safe_baseline },
+    { LZ4_compress_noDict_sse41,    LZ4_decompress_safe_sse41 },
+    { LZ4_compress_noDict_avx2,     LZ4_decompress_safe_avx2 },
+};
+
+/* written at startup (the constructor, or the first LZ4_kernels() call if earlier : both store the same value)
+ * and by LZ4_setCpuVariant(), read by every kernel call.
+ * Accessed with relaxed atomics (LZ4_DISPATCH implies gcc or clang) : threads racing on the first resolve are
+ * well defined, and it points into a constant table, so no ordering is needed. It is a plain load on x86. */
+static const LZ4_kernels_t* LZ4_activeKernels = NULL;
+
+static LZ4_cpuVariant_e LZ4_detectCpuVariant(void)
+{
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi") && __builtin_cpu_supports("bmi2"))
+        return LZ4_cpu_avx2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return LZ4_cpu_sse41;
+    return LZ4_cpu_baseline;
+}
+
+static const LZ4_kernels_t* LZ4_resolveKernels(void)
+{
+    const LZ4_kernels_t* const kernels = &LZ4_kernelTable[LZ4_detectCpuVariant()];
+    __atomic_store_n(&LZ4_activeKernels, kernels, __ATOMIC_RELAXED);
+    return kernels;
+}
+
+/* resolved before main(); LZ4_kernels() still resolves on its own if called from an earlier constructor */
+__attribute__((constructor)) static void LZ4_initDispatch(void)
+{
+    if (__atomic_load_n(&LZ4_activeKernels, __ATOMIC_RELAXED) == NULL) LZ4_resolveKernels();
+}
+
+static const LZ4_kernels_t* LZ4_kernels(void)
+{
+    const LZ4_kernels_t* const kernels = __atomic_load_n(&LZ4_activeKernels, __ATOMIC_RELAXED);
+    if (unlikely(kernels == NULL)) return LZ4_resolveKernels();
+    return kernels;
+}
+
+LZ4_cpuVariant_e LZ4_getCpuVariant(void)
+{
+    return (LZ4_cpuVariant_e)(LZ4_kernels() - LZ4_kernelTable);
+}
+
+int LZ4_isCpuVariantSupported(LZ4_cpuVariant_e variant)
+{
+    return (variant >= LZ4_cpu_baseline) && (variant <= LZ4_detectCpuVariant());
+}
+
+int LZ4_setCpuVariant(LZ4_cpuVariant_e variant)
+{
+    if (variant == LZ4_cpu_auto) { LZ4_resolveKernels(); return 0; }
+    if (!LZ4_isCpuVariantSupported(variant)) return -1;
+    __atomic_store_n(&LZ4_activeKernels, &LZ4_kernelTable[variant], __ATOMIC_RELAXED);
+    return 0;
+}
+
+#else
+
+LZ4_cpuVariant_e LZ4_getCpuVariant(void) { return LZ4_cpu_baseline; }
+int LZ4_isCpuVariantSupported(LZ4_cpuVariant_e variant) { return variant == LZ4_cpu_baseline; }
+int LZ4_setCpuVariant(LZ4_cpuVariant_e variant)
+{
+    return ((variant == LZ4_cpu_auto) || (variant == LZ4_cpu_baseline)) ? 0 : -1;
+}
+
+#endif /* LZ4_DISPATCH */
+
+
 /*===== Instantiate the API decoding functions. =====*/
 
 LZ4_FORCE_O2_GCC_PPC64LE
 int LZ4_decompress_safe(const char* source, char* dest, int compressedSize, int maxDecompressedSize)
 {
-    return LZ4_decompress_generic(source, dest, compressedSize, maxDecompressedSize,
-                                  endOnInputSize, decode_full_block, noDict,
-                                  (BYTE*)dest, NULL, 0);
+    return LZ4_DECOMPRESS_SAFE(source, dest, compressedSize, maxDecompressedSize,
+                               noDict, (BYTE*)dest, NULL, 0);
 }
 
 LZ4_FORCE_O2_GCC_PPC64LE
@@ -1677,9 +2436,8 @@ int LZ4_decompress_fast(const char* source, char* dest, int originalSize)
 LZ4_FORCE_O2_GCC_PPC64LE /* Exported, an obsolete API function. */
 int LZ4_decompress_safe_withPrefix64k(const char* source, char* dest, int compressedSize, int maxOutputSize)
 {
-    return LZ4_decompress_generic(source, dest, compressedSize, maxOutputSize,
-                                  endOnInputSize, decode_full_block, withPrefix64k,
-                                  (BYTE*)dest - 64 KB, NULL, 0);
+    return LZ4_DECOMPRESS_SAFE(source, dest, compressedSize, maxOutputSize,
+                               withPrefix64k, (BYTE*)dest - 64 KB, NULL, 0);
 }
 
 /* Another obsolete API function, paired with the previous one. */
@@ -1694,9 +2452,8 @@ LZ4_FORCE_O2_GCC_PPC64LE
 static int LZ4_decompress_safe_withSmallPrefix(const char* source, char* dest, int compressedSize, int maxOutputSize,
                                                size_t prefixSize)
 {
-    return LZ4_decompress_generic(source, dest, compressedSize, maxOutputSize,
-                                  endOnInputSize, decode_full_block, noDict,
-                                  (BYTE*)dest-prefixSize, NULL, 0);
+    return LZ4_DECOMPRESS_SAFE(source, dest, compressedSize, maxOutputSize,
+                               noDict, (BYTE*)dest-prefixSize, NULL, 0);
 }
 
 LZ4_FORCE_O2_GCC_PPC64LE
@@ -1704,9 +2461,8 @@ int LZ4_decompress_safe_forceExtDict(const char* source, char* dest,
                                      int compressedSize, int maxOutputSize,
                                      const void* dictStart, size_t dictSize)
 {
-    return LZ4_decompress_generic(source, dest, compressedSize, maxOutputSize,
-                                  endOnInputSize, decode_full_block, usingExtDict,
-                                  (BYTE*)dest, (const BYTE*)dictStart, dictSize);
+    return LZ4_DECOMPRESS_SAFE(source, dest, compressedSize, maxOutputSize,
+                               usingExtDict, (BYTE*)dest, (const BYTE*)dictStart, dictSize);
 }
 
 LZ4_FORCE_O2_GCC_PPC64LE
@@ -1726,9 +2482,8 @@ LZ4_FORCE_INLINE
 int LZ4_decompress_safe_doubleDict(const char* source, char* dest, int compressedSize, int maxOutputSize,
                                    size_t prefixSize, const void* dictStart, size_t dictSize)
 {
-    return LZ4_decompress_generic(source, dest, compressedSize, maxOutputSize,
-                                  endOnInputSize, decode_full_block, usingExtDict,
-                                  (BYTE*)dest-prefixSize, (const BYTE*)dictStart, dictSize);
+    return LZ4_DECOMPRESS_SAFE(source, dest, compressedSize, maxOutputSize,
+                               usingExtDict, (BYTE*)dest-prefixSize, (const BYTE*)dictStart, dictSize);
 }
 
 LZ4_FORCE_INLINE
@@ -1899,6 +2654,436 @@ int LZ4_decompress_fast_usingDict(const char* source, char* dest, int originalSi
 }
 
 
+/*-*******************************
+ *  Batch functions
+ ********************************/
+
+#define LZ4_BATCH_SHARDS_MAX 64
+
+/* LZ4_batchShards() :
+ * number of shards a batch of nbItems is split into */
+static int LZ4_batchShards(const LZ4_batchOptions_t* options, int nbItems)
+{
+    int const nbThreads = options ? MIN(options->nbThreads, LZ4_BATCH_SHARDS_MAX) : 1;
+    if (nbThreads <= 1) return 1;
+    return MIN(nbThreads, nbItems);
+}
+
+#if LZ4_BATCH_THREADS
+typedef struct {
+    LZ4_batchJob_f job;
+    void* jobCtx;
+    int jobIndex;
+#  if defined(_WIN32)
+    HANDLE handle;
+#  else
+    pthread_t handle;
+#  endif
+    int started;
+} LZ4_batchThread_t;
+
+#  if defined(_WIN32)
+static DWORD WINAPI LZ4_batchThreadMain(LPVOID arg)
+#  else
+static void* LZ4_batchThreadMain(void* arg)
+#  endif
+{
+    LZ4_batchThread_t* const thread = (LZ4_batchThread_t*)arg;
+    thread->job(thread->jobCtx, thread->jobIndex);
+    return 0;
+}
+#endif
+
+/* LZ4_runBatchJobs() :
+ * runs job(jobCtx, i) for each i in [0, nbJobs) : on the caller's runner if any,
+ * else on nbJobs-1 internal threads plus the calling one, else one after the other.
+ * Jobs which can't get a thread run on the calling thread. */
+static void LZ4_runBatchJobs(const LZ4_batchOptions_t* options, LZ4_batchJob_f job, void* jobCtx, int nbJobs)
+{
+    int i;
+    if ((nbJobs > 1) && options && options->runner) {
+        options->runner(options->runnerCtx, job, jobCtx, nbJobs);
+        return;
+    }
+#if LZ4_BATCH_THREADS
+    if (nbJobs > 1) {
+        LZ4_batchThread_t* const threads = (LZ4_batchThread_t*)ALLOC_AND_ZERO(sizeof(LZ4_batchThread_t) * (size_t)nbJobs);
+        if (threads != NULL) {
+            for (i=1; i<nbJobs; i++) {
+                threads[i].job = job;
+                threads[i].jobCtx = jobCtx;
+                threads[i].jobIndex = i;
+#  if defined(_WIN32)
+                threads[i].handle = CreateThread(NULL, 0, LZ4_batchThreadMain, &threads[i], 0, NULL);
+                threads[i].started = (threads[i].handle != NULL);
+#  else
+                threads[i].started = (pthread_create(&threads[i].handle, NULL, LZ4_batchThreadMain, &threads[i]) == 0);
+#  endif
+            }
+            job(jobCtx, 0);
+            for (i=1; i<nbJobs; i++) {
+                if (!threads[i].started) { job(jobCtx, i); continue; }
+#  if defined(_WIN32)
+                WaitForSingleObject(threads[i].handle, INFINITE);
+                CloseHandle(threads[i].handle);
+#  else
+                pthread_join(threads[i].handle, NULL);
+#  endif
+            }
+            FREEMEM(threads);
+            return;
+    }   }
+#endif
+    for (i=0; i<nbJobs; i++) job(jobCtx, i);
+}
+
+int LZ4_compress_batch_extState(void* state, LZ4_batchItem_t* items, int nbItems, int acceleration)
+{
+    int failed = 0;
+    int i;
+    for (i=0; i<nbItems; i++) {
+        LZ4_batchItem_t* const item = items + i;
+        item->result = LZ4_compress_fast_extState_fastReset(state, item->src, item->dst, item->srcSize, item->dstCapacity, acceleration);
+        failed += (item->result == 0);
+    }
+    return failed;
+}
+
+typedef struct {
+    LZ4_batchItem_t* items;
+    const int* shardStart;   /* nbShards+1 item indexes */
+    int acceleration;
+    int hashLog;
+    int* shardFailed;
+} LZ4_compressBatch_t;
+
+static void LZ4_compressBatchShard(void* jobCtx, int shard)
+{
+    LZ4_compressBatch_t* const batch = (LZ4_compressBatch_t*)jobCtx;
+    int const first = batch->shardStart[shard];
+    int const nbItems = batch->shardStart[shard+1] - first;
+    LZ4_stream_t* const state = batch->hashLog ? LZ4_createStreamHashLog(batch->hashLog) : LZ4_createStream();
+    if (state == NULL) {   /* out of memory : the whole shard fails */
+        int i;
+        for (i=0; i<nbItems; i++) batch->items[first+i].result = 0;
+        batch->shardFailed[shard] = nbItems;
+        return;
+    }
+    batch->shardFailed[shard] = LZ4_compress_batch_extState(state, batch->items + first, nbItems, batch->acceleration);
+    LZ4_freeStream(state);
+}
+
+int LZ4_compress_batch(LZ4_batchItem_t* items, int nbItems, const LZ4_batchOptions_t* options)
+{
+    int const nbShards = LZ4_batchShards(options, nbItems);
+    int shardStart[LZ4_BATCH_SHARDS_MAX+1];
+    int shardFailed[LZ4_BATCH_SHARDS_MAX];
+    LZ4_compressBatch_t batch;
+    int failed = 0;
+    int i;
+
+    if (nbItems <= 0) return 0;
+    if ((options != NULL) && (options->hashLog != 0) && (LZ4_sizeofStateHashLog(options->hashLog) == 0)) return -1;   /* invalid hashLog */
+    batch.items = items;
+    batch.shardStart = shardStart;
+    batch.acceleration = options ? options->acceleration : ACCELERATION_DEFAULT;
+    batch.hashLog = options ? options->hashLog : 0;
+    batch.shardFailed = shardFailed;
+
+    /* contiguous shards of about the same number of input bytes */
+    {   U64 total = 0, done = 0;
+        int shard = 1;
+        for (i=0; i<nbItems; i++) total += (U64)(items[i].srcSize > 0 ? items[i].srcSize : 0) + 1;
+        shardStart[0] = 0;
+        for (i=0; (i<nbItems) && (shard<nbShards); i++) {
+            done += (U64)(items[i].srcSize > 0 ? items[i].srcSize : 0) + 1;
+            if (done * (U64)nbShards >= total * (U64)shard) shardStart[shard++] = i+1;
+        }
+        while (shard <= nbShards) shardStart[shard++] = nbItems;
+    }
+
+    LZ4_runBatchJobs(options, LZ4_compressBatchShard, &batch, nbShards);
+
+    for (i=0; i<nbShards; i++) failed += shardFailed[i];
+    return failed;
+}
+
+typedef struct {
+    int size;
+    int index;
+} LZ4_batchOrder_t;
+
+/* largest first, then in item order */
+static int LZ4_batchOrderCmp(const void* a, const void* b)
+{
+    const LZ4_batchOrder_t* const oa = (const LZ4_batchOrder_t*)a;
+    const LZ4_batchOrder_t* const ob = (const LZ4_batchOrder_t*)b;
+    if (oa->size != ob->size) return (oa->size > ob->size) ? -1 : 1;
+    return (oa->index > ob->index) - (oa->index < ob->index);
+}
+
+typedef struct {
+    LZ4_batchItem_t* items;
+    const int* order;        /* item indexes grouped by shard, or NULL for item order */
+    const int* shardStart;   /* nbShards+1 indexes into order */
+    int* shardFailed;
+} LZ4_decompressBatch_t;
+
+static void LZ4_decompressBatchShard(void* jobCtx, int shard)
+{
+    LZ4_decompressBatch_t* const batch = (LZ4_decompressBatch_t*)jobCtx;
+    int failed = 0;
+    int i;
+    for (i=batch->shardStart[shard]; i<batch->shardStart[shard+1]; i++) {
+        LZ4_batchItem_t* const item = batch->items + (batch->order ? batch->order[i] : i);
+        if (i+1 < batch->shardStart[shard+1]) {   /* the next block is fetched while this one is decoded */
+            const LZ4_batchItem_t* const next = batch->items + (batch->order ? batch->order[i+1] : i+1);
+            LZ4_PREFETCH(next->src);
+            LZ4_PREFETCH(next->src + 64);
+            LZ4_PREFETCH(next->dst);
+        }
+        item->result = LZ4_decompress_safe(item->src, item->dst, item->srcSize, item->dstCapacity);
+        failed += (item->result < 0);
+    }
+    batch->shardFailed[shard] = failed;
+}
+
+int LZ4_decompress_batch(LZ4_batchItem_t* items, int nbItems, const LZ4_batchOptions_t* options)
+{
+    int nbShards = LZ4_batchShards(options, nbItems);
+    int shardStart[LZ4_BATCH_SHARDS_MAX+1];
+    int shardFailed[LZ4_BATCH_SHARDS_MAX];
+    LZ4_batchOrder_t* sorted = NULL;
+    LZ4_decompressBatch_t batch;
+    int failed = 0;
+    int i;
+
+    if (nbItems <= 0) return 0;
+    batch.items = items;
+    batch.order = NULL;
+    batch.shardStart = shardStart;
+    batch.shardFailed = shardFailed;
+
+    if (nbShards > 1) {
+        /* largest blocks first, each to the least loaded shard,
+         * so that no shard is left with a big block at the end */
+        sorted = (LZ4_batchOrder_t*)ALLOC(sizeof(LZ4_batchOrder_t) * (size_t)nbItems + sizeof(int) * (size_t)nbItems);
+        if (sorted == NULL) nbShards = 1;   /* out of memory : decode in item order on the calling thread */
+    }
+    if (sorted != NULL) {
+        int* const order = (int*)(sorted + nbItems);
+        U64 load[LZ4_BATCH_SHARDS_MAX];
+        int shardCount[LZ4_BATCH_SHARDS_MAX];
+        int s;
+        for (i=0; i<nbItems; i++) {
+            sorted[i].size = items[i].srcSize > 0 ? items[i].srcSize : 0;
+            sorted[i].index = i;
+        }
+        qsort(sorted, (size_t)nbItems, sizeof(LZ4_batchOrder_t), LZ4_batchOrderCmp);
+        for (s=0; s<nbShards; s++) { load[s] = 0; shardCount[s] = 0; }
+        for (i=0; i<nbItems; i++) {
+            int best = 0;
+            for (s=1; s<nbShards; s++) if (load[s] < load[best]) best = s;
+            load[best] += (U64)sorted[i].size + 1;
+            shardCount[best]++;
+            sorted[i].size = best;   /* from now on : shard of the item */
+        }
+        shardStart[0] = 0;
+        for (s=0; s<nbShards; s++) shardStart[s+1] = shardStart[s] + shardCount[s];
+        for (s=0; s<nbShards; s++) shardCount[s] = shardStart[s];
+        for (i=0; i<nbItems; i++) order[shardCount[sorted[i].size]++] = sorted[i].index;
+        batch.order = order;
+    } else {
+        shardStart[0] = 0;
+        shardStart[1] = nbItems;
+    }
+
+    LZ4_runBatchJobs(options, LZ4_decompressBatchShard, &batch, nbShards);
+
+    for (i=0; i<nbShards; i++) failed += shardFailed[i];
+    FREEMEM(sorted);
+    return failed;
+}
+
+
+/*-*******************************
+ *  Large input functions
+ ********************************/
+
+/* LZ4 frame (see ../doc/lz4_Frame_format.md) : no content size, no checksum, linked blocks of 4 MB.
+ * Its header checksum is constant : (XXH32(FLG BD, 2, 0) >> 8) & 0xFF */
+#define LZ4_LARGE_BLOCKSIZE (4 MB)
+#define LZ4_LARGE_HEADERSIZE 7
+#define LZ4_LARGE_ENDMARKSIZE 4
+#define LZ4_LARGE_UNCOMPRESSED 0x80000000U
+static const BYTE LZ4_largeHeader[LZ4_LARGE_HEADERSIZE] = { 0x04, 0x22, 0x4D, 0x18, 0x40, 0x70, 0xDF };
+
+static U32 LZ4_readLE32(const void* memPtr)
+{
+    const BYTE* const p = (const BYTE*)memPtr;
+    return (U32)p[0] + ((U32)p[1]<<8) + ((U32)p[2]<<16) + ((U32)p[3]<<24);
+}
+
+static void LZ4_writeLE32(void* memPtr, U32 value)
+{
+    BYTE* const p = (BYTE*)memPtr;
+    p[0] = (BYTE) value;
+    p[1] = (BYTE)(value>>8);
+    p[2] = (BYTE)(value>>16);
+    p[3] = (BYTE)(value>>24);
+}
+
+size_t LZ4_compressBound_large(size_t srcSize)
+{
+    size_t const nbBlocks = srcSize / LZ4_LARGE_BLOCKSIZE + 1;
+    size_t const overhead = LZ4_LARGE_HEADERSIZE + 4*nbBlocks + LZ4_LARGE_ENDMARKSIZE;
+    if (srcSize > (size_t)-1 - overhead) return 0;   /* too large */
+    return srcSize + overhead;
+}
+
+typedef struct {
+    const BYTE* src;
+    size_t srcSize;
+    size_t firstBlock;           /* of the current window */
+    int acceleration;
+    LZ4_stream_t** states;       /* one per job */
+    BYTE** targets;
+    int* capacities;
+    int* results;
+} LZ4_compressLarge_t;
+
+/* LZ4_compressLargeBlock() :
+ * each block uses the previous 64 KB as a dictionary (decodable as linked blocks),
+ * loaded with LZ4_loadDict(), so blocks don't depend on each other's compression */
+static void LZ4_compressLargeBlock(void* jobCtx, int job)
+{
+    LZ4_compressLarge_t* const large = (LZ4_compressLarge_t*)jobCtx;
+    size_t const start = (large->firstBlock + (size_t)job) * LZ4_LARGE_BLOCKSIZE;
+    int const blockSize = (int)MIN(large->srcSize - start, LZ4_LARGE_BLOCKSIZE);
+    int const dictSize = (int)MIN(start, 64 KB);
+    LZ4_loadDict(large->states[job], (const char*)large->src + start - dictSize, dictSize);
+    large->results[job] = LZ4_compress_fast_continue(large->states[job], (const char*)large->src + start, (char*)large->targets[job],
+                                                     blockSize, large->capacities[job], large->acceleration);
+}
+
+size_t LZ4_compress_large(const char* src, char* dst, size_t srcSize, size_t dstCapacity, const LZ4_batchOptions_t* options)
+{
+    size_t const nbBlocks = (srcSize + LZ4_LARGE_BLOCKSIZE - 1) / LZ4_LARGE_BLOCKSIZE;
+    int const nbJobs = (nbBlocks > 1) ? LZ4_batchShards(options, (int)MIN(nbBlocks, LZ4_BATCH_SHARDS_MAX)) : 1;
+    int const hashLog = options ? options->hashLog : 0;
+    LZ4_stream_t* states[LZ4_BATCH_SHARDS_MAX];
+    BYTE* targets[LZ4_BATCH_SHARDS_MAX];
+    int capacities[LZ4_BATCH_SHARDS_MAX];
+    int results[LZ4_BATCH_SHARDS_MAX];
+    BYTE* scratch = NULL;   /* one block per job, when blocks are compressed in parallel */
+    LZ4_compressLarge_t large;
+    BYTE* const ostart = (BYTE*)dst;
+    BYTE* op = ostart;
+    size_t block;
+    size_t result = 0;
+    int j;
+
+    if ((hashLog != 0) && (LZ4_sizeofStateHashLog(hashLog) == 0)) return 0;   /* invalid hashLog */
+    if (dstCapacity < LZ4_LARGE_HEADERSIZE + LZ4_LARGE_ENDMARKSIZE) return 0;
+    large.src = (const BYTE*)src;
+    large.srcSize = srcSize;
+    large.acceleration = options ? options->acceleration : ACCELERATION_DEFAULT;
+    large.states = states;
+    large.targets = targets;
+    large.capacities = capacities;
+    large.results = results;
+
+    for (j=0; j<nbJobs; j++) states[j] = NULL;
+    for (j=0; j<nbJobs; j++) {
+        states[j] = hashLog ? LZ4_createStreamHashLog(hashLog) : LZ4_createStream();
+        if (states[j] == NULL) goto _cleanup;
+    }
+    if (nbJobs > 1) {
+        scratch = (BYTE*)ALLOC((size_t)nbJobs * LZ4_LARGE_BLOCKSIZE);
+        if (scratch == NULL) goto _cleanup;
+    }
+
+    memcpy(op, LZ4_largeHeader, LZ4_LARGE_HEADERSIZE);
+    op += LZ4_LARGE_HEADERSIZE;
+    for (block=0; block<nbBlocks; block+=(size_t)nbJobs) {
+        int const n = (int)MIN(nbBlocks - block, (size_t)nbJobs);
+        large.firstBlock = block;
+        for (j=0; j<n; j++) {
+            size_t const blockSize = MIN(srcSize - (block + (size_t)j) * LZ4_LARGE_BLOCKSIZE, LZ4_LARGE_BLOCKSIZE);
+            if (scratch == NULL) {   /* directly in place, limited to what dst has left */
+                size_t const used = (size_t)(op - ostart) + 4 + LZ4_LARGE_ENDMARKSIZE;
+                targets[j] = op + 4;
+                capacities[j] = (int)MIN(blockSize - 1, used <= dstCapacity ? dstCapacity - used : 0);
+            } else {
+                targets[j] = scratch + (size_t)j * LZ4_LARGE_BLOCKSIZE;
+                capacities[j] = (int)blockSize - 1;   /* compressed blocks must be smaller than stored ones */
+            }
+        }
+        LZ4_runBatchJobs(options, LZ4_compressLargeBlock, &large, n);
+
+        for (j=0; j<n; j++) {
+            size_t const start = (block + (size_t)j) * LZ4_LARGE_BLOCKSIZE;
+            size_t const blockSize = MIN(srcSize - start, LZ4_LARGE_BLOCKSIZE);
+            size_t const cSize = results[j] ? (size_t)results[j] : blockSize;
+            if (dstCapacity - (size_t)(op - ostart) < 4 + cSize + LZ4_LARGE_ENDMARKSIZE) goto _cleanup;   /* dst too small */
+            if (results[j] == 0) {   /* not compressible : stored as is */
+                LZ4_writeLE32(op, (U32)blockSize | LZ4_LARGE_UNCOMPRESSED);
+                memcpy(op + 4, src + start, blockSize);
+            } else {
+                LZ4_writeLE32(op, (U32)cSize);
+                if (scratch != NULL) memcpy(op + 4, targets[j], cSize);
+            }
+            op += 4 + cSize;
+        }
+    }
+    LZ4_writeLE32(op, 0);   /* end mark */
+    op += LZ4_LARGE_ENDMARKSIZE;
+    result = (size_t)(op - ostart);
+
+_cleanup:
+    for (j=0; j<nbJobs; j++) LZ4_freeStream(states[j]);
+    FREEMEM(scratch);
+    return result;
+}
+
+size_t LZ4_decompress_large(const char* src, char* dst, size_t compressedSize, size_t dstCapacity)
+{
+    const BYTE* ip = (const BYTE*)src;
+    const BYTE* const iend = ip + compressedSize;
+    size_t op = 0;
+
+    if (compressedSize < LZ4_LARGE_HEADERSIZE + LZ4_LARGE_ENDMARKSIZE) return LZ4_LARGE_ERROR;
+    if (memcmp(ip, LZ4_largeHeader, LZ4_LARGE_HEADERSIZE)) return LZ4_LARGE_ERROR;   /* not written by LZ4_compress_large() */
+    ip += LZ4_LARGE_HEADERSIZE;
+
+    for (;;) {
+        U32 blockHeader;
+        size_t cSize;
+        size_t const maxOutput = MIN(dstCapacity - op, LZ4_LARGE_BLOCKSIZE);
+        if ((size_t)(iend - ip) < 4) return LZ4_LARGE_ERROR;
+        blockHeader = LZ4_readLE32(ip);
+        ip += 4;
+        if (blockHeader == 0) break;   /* end mark */
+        cSize = blockHeader & ~LZ4_LARGE_UNCOMPRESSED;
+        if ((cSize > LZ4_LARGE_BLOCKSIZE) || (cSize > (size_t)(iend - ip))) return LZ4_LARGE_ERROR;
+        if (blockHeader & LZ4_LARGE_UNCOMPRESSED) {
+            if (cSize > maxOutput) return LZ4_LARGE_ERROR;
+            memcpy(dst + op, ip, cSize);
+            op += cSize;
+        } else {
+            /* the previous output is the block's prefix, as in LZ4_decompress_safe_continue() */
+            int const dictSize = (int)MIN(op, 64 KB);
+            int const r = LZ4_decompress_safe_usingDict((const char*)ip, dst + op, (int)cSize, (int)maxOutput, dst + op - dictSize, dictSize);
+            if (r < 0) return LZ4_LARGE_ERROR;
+            op += (size_t)r;
+        }
+        ip += cSize;
+    }
+    if (ip != iend) return LZ4_LARGE_ERROR;   /* trailing bytes */
+    return op;
+}
+
+
 /*=*************************************************
 *  Obsolete Functions
 ***************************************************/
@@ -251,6 +251,26 @@ LZ4LIB_API int LZ4_decompress_fast (const char* src, char* dst, int originalSize
  */
 LZ4LIB_API int LZ4_decompress_safe_partial (const char* src, char* dst, int srcSize, int targetOutputSize, int dstCapacity);
 
+/*! LZ4_decompressInplaceBufferSize() :
+ *  In-place decompression : the compressed block is stored at the *tail* of a buffer,
+ *  and LZ4_decompress_safe() regenerates data from the *beginning* of that same buffer.
+ *  The decoder reads input ahead of where it writes output,
+ *  so decoded data never overwrites input which has not been read yet,
+ *  provided the buffer is at least LZ4_DECOMPRESS_INPLACE_BUFFER_SIZE(decompressedSize) bytes
+ *  and the compressed block ends exactly at the end of the buffer.
+ *  Any block produced by LZ4_compress_*() (hence <= LZ4_compressBound(decompressedSize)) fits within this size.
+ *  Typical usage :
+ *      bufferSize = LZ4_DECOMPRESS_INPLACE_BUFFER_SIZE(decompressedSize);
+ *      src = buffer + bufferSize - compressedSize;   (load or move compressed data there)
+ *      LZ4_decompress_safe(src, buffer, compressedSize, decompressedSize);
+ *  Macro LZ4_DECOMPRESS_INPLACE_BUFFER_SIZE() is also provided for compilation-time evaluation.
+ * @return : minimum buffer size for in-place decompression,
+ *           or 0, if decompressedSize is incorrect (too large or negative)
+ */
+#define LZ4_DECOMPRESS_INPLACE_MARGIN(decompressedSize)        (((decompressedSize) / 255) + 32)
+#define LZ4_DECOMPRESS_INPLACE_BUFFER_SIZE(decompressedSize)   ((decompressedSize) + LZ4_DECOMPRESS_INPLACE_MARGIN(decompressedSize))
+LZ4LIB_API int LZ4_decompressInplaceBufferSize(int decompressedSize);
+
 
 /*-*********************************************
 *  Streaming Compression Functions
@@ -477,6 +497,174 @@ LZ4LIB_API int LZ4_compress_fast_extState_fastReset (void* state, const char* sr
  */
 LZ4LIB_API void LZ4_attach_dictionary(LZ4_stream_t *working_stream, const LZ4_stream_t *dictionary_stream);
 
+/*! LZ4_saveDictBlob() :
+ *  Saves a dictionary stream, prepared by LZ4_loadDict(), with a copy of its dictionary,
+ *  into `blob`, which can be written to a file, shipped, and later loaded with LZ4_loadDictBlob()
+ *  instead of running LZ4_loadDict() again.
+ *  `blob` must be 8-bytes aligned, and at least LZ4_sizeofDictBlob(dictStream) bytes.
+ * @return : the size of the blob, or 0 if `dictStream` wasn't prepared by LZ4_loadDict() or `blobCapacity` is too small */
+LZ4LIB_API size_t LZ4_sizeofDictBlob(const LZ4_stream_t* dictStream);
+LZ4LIB_API size_t LZ4_saveDictBlob(const LZ4_stream_t* dictStream, void* blob, size_t blobCapacity);
+
+/*! LZ4_loadDictBlob() :
+ *  Turns a blob saved by LZ4_saveDictBlob() back into a dictionary stream, in O(1) : nothing is hashed nor copied.
+ *  The blob is checked to come from the same library version, on a machine with the same byte order
+ *  and pointer size, and built with the same LZ4_MEMORY_USAGE; otherwise, rebuild the stream with LZ4_loadDict().
+ *  Its content is trusted otherwise : only load blobs from a trusted source.
+ *  `blob` must be 8-bytes aligned (malloc(), mmap() ...), and writable : loading patches the stream's pointers
+ *  into it, once. A read-only file can be mapped copy-on-write (MAP_PRIVATE), which only duplicates one page.
+ *  From then on, the stream is only read : it can be attached to any number of working streams,
+ *  from any threads, with LZ4_attach_dictionary(), as long as `blob` stays in place.
+ * @return : the dictionary stream, within `blob`, or NULL if the blob is invalid or incompatible */
+LZ4LIB_API const LZ4_stream_t* LZ4_loadDictBlob(void* blob, size_t blobSize);
+
+/*! LZ4_initStreamHashLog() :
+ *  Prepares `buffer` as a stream whose hash table has (1 << hashLog) entries,
+ *  instead of the LZ4_HASH_SIZE_U32 set at compile time by LZ4_MEMORY_USAGE.
+ *  `hashLog` must be within [LZ4_HASHLOG_MIN, LZ4_HASHLOG_MAX] (a 4 KB to 4 MB table).
+ *  Small tables stay in L1 cache and are cheap to reset when compressing small blocks,
+ *  large ones find more matches in large inputs.
+ *  `buffer` must be aligned like LZ4_stream_t (8 bytes), and at least LZ4_STREAMSIZE_HASHLOG(hashLog) bytes.
+ *
+ *  The result is used like any LZ4_stream_t, with LZ4_compress_fast_extState_fastReset(),
+ *  LZ4_resetStream_fast(), LZ4_loadDict(), LZ4_compress_fast_continue(), LZ4_saveDict() and LZ4_attach_dictionary().
+ *  A dictionary stream is only attached to a working stream of the same hashLog.
+ *  LZ4_resetStream() and LZ4_compress_fast_extState() turn it back into a default stream.
+ * @return : the stream, or NULL if `hashLog` is out of range or `size` too small */
+LZ4LIB_API LZ4_stream_t* LZ4_initStreamHashLog(void* buffer, size_t size, int hashLog);
+
+/*! LZ4_createStreamHashLog() :
+ *  Allocates and initializes a stream like LZ4_initStreamHashLog(). Release it with LZ4_freeStream().
+ * @return : the stream, or NULL if `hashLog` is out of range or allocation failed */
+LZ4LIB_API LZ4_stream_t* LZ4_createStreamHashLog(int hashLog);
+
+/*! LZ4_sizeofStateHashLog() :
+ * @return : LZ4_STREAMSIZE_HASHLOG(hashLog), or 0 if `hashLog` is out of range */
+LZ4LIB_API int LZ4_sizeofStateHashLog(int hashLog);
+
+/*! LZ4_compress_fast_extStateHashLog() :
+ *  Same as LZ4_compress_fast_extState(), with a hash table of (1 << hashLog) entries.
+ *  `state` is at least LZ4_sizeofStateHashLog(hashLog) bytes, and is left initialized
+ *  for LZ4_compress_fast_extState_fastReset().
+ * @return : the compressed size, or 0 on failure (including an invalid `hashLog`) */
+LZ4LIB_API int LZ4_compress_fast_extStateHashLog (void* state, const char* src, char* dst, int srcSize, int dstCapacity, int acceleration, int hashLog);
+
+/*! LZ4_cpuVariant_e :
+ *  When built with LZ4_DISPATCH (default with gcc/clang on x86),
+ *  the one-shot block compressor (LZ4_compress_fast_extState() and its callers)
+ *  and the safe block decoder (LZ4_decompress_safe*(), with or without dictionary)
+ *  are compiled once per instruction set, from the same source.
+ *  The best variant supported by the CPU is selected at startup.
+ *  Other builds only have LZ4_cpu_baseline.
+ */
+typedef enum {
+    LZ4_cpu_auto = -1,      /* for LZ4_setCpuVariant() : the best one supported, as selected at startup */
+    LZ4_cpu_baseline = 0,   /* the instruction set the library is built for */
+    LZ4_cpu_sse41 = 1,
+    LZ4_cpu_avx2 = 2,       /* AVX2 + BMI + BMI2 */
+    LZ4_cpu_count
+} LZ4_cpuVariant_e;
+
+/*! LZ4_getCpuVariant() :
+ * @return : the variant currently in use */
+LZ4LIB_API LZ4_cpuVariant_e LZ4_getCpuVariant(void);
+
+/*! LZ4_isCpuVariantSupported() :
+ * @return : 1 if this build has `variant` and the CPU can run it, 0 otherwise */
+LZ4LIB_API int LZ4_isCpuVariantSupported(LZ4_cpuVariant_e variant);
+
+/*! LZ4_setCpuVariant() :
+ *  Forces a variant, typically to benchmark them against each other.
+ *  Not thread-safe : call it while no other thread is compressing or decompressing.
+ * @return : 0 on success, -1 if `variant` is not supported (the current one is kept) */
+LZ4LIB_API int LZ4_setCpuVariant(LZ4_cpuVariant_e variant);
+
+/*! LZ4_isCompressible() :
+ *  Cheap estimate of whether compressing `src` is worth trying, for data of unknown kind :
+ *  looks for matches and measures the byte distribution in a few KB sampled over `src`,
+ *  which takes a small fraction of the time LZ4 spends on incompressible input.
+ *  Already compressed data (png, jpg, audio, archives ...) and random data are reported incompressible.
+ * @return : 1 if compression is likely to save space, 0 if `src` is better stored as is */
+LZ4LIB_API int LZ4_isCompressible(const char* src, int srcSize);
+
+/*! LZ4_batchItem_t :
+ *  One independent block of a batch : `src`, `srcSize` and `dst`, `dstCapacity` are set by the caller,
+ *  `result` is filled by the batch function, as the value the equivalent one-shot call would have returned. */
+typedef struct {
+    const char* src;
+    char* dst;
+    int srcSize;
+    int dstCapacity;
+    int result;
+} LZ4_batchItem_t;
+
+/*! LZ4_batchRunner_f :
+ *  Lets a batch run on the caller's thread pool.
+ *  It must call `job(jobCtx, jobIndex)` once for each jobIndex in [0, nbJobs), from any threads,
+ *  and only return once all of them have returned. */
+typedef void (*LZ4_batchJob_f)(void* jobCtx, int jobIndex);
+typedef void (*LZ4_batchRunner_f)(void* runnerCtx, LZ4_batchJob_f job, void* jobCtx, int nbJobs);
+
+/*! LZ4_batchOptions_t :
+ *  Zero-initialize it, then set the fields needed. A NULL options pointer means all defaults.
+ *  Batches are split into `nbThreads` shards of about the same size, compressed or decompressed in parallel :
+ *  by `runner` if set, else by internal threads (builds with LZ4_BATCH_THREADS), else one after the other. */
+typedef struct {
+    int acceleration;           /* compression : <= 0 means default */
+    int hashLog;                /* compression : 0 for the default table, else see LZ4_initStreamHashLog() */
+    int nbThreads;              /* <= 1 : everything runs on the calling thread. At most 64 shards */
+    LZ4_batchRunner_f runner;   /* optional */
+    void* runnerCtx;
+} LZ4_batchOptions_t;
+
+/*! LZ4_compress_batch_extState() :
+ *  Compresses `nbItems` independent blocks, like LZ4_compress_fast_extState_fastReset() called on each of them,
+ *  reusing a single `state` : its table is only reset when needed (see LZ4_resetStream_fast()),
+ *  which makes batches of small blocks much cheaper than one LZ4_compress_default() per block.
+ *  `state` must be initialized (LZ4_createStream(), LZ4_resetStream(), LZ4_initStreamHashLog() ...).
+ * @return : the number of items which failed (their `result` is 0) */
+LZ4LIB_API int LZ4_compress_batch_extState(void* state, LZ4_batchItem_t* items, int nbItems, int acceleration);
+
+/*! LZ4_compress_batch() :
+ *  Same as LZ4_compress_batch_extState(), with one state per shard, allocated for the call (see LZ4_batchOptions_t).
+ *  The items of a shard whose state can't be allocated fail.
+ * @return : the number of items which failed, or -1 if `options->hashLog` is invalid */
+LZ4LIB_API int LZ4_compress_batch(LZ4_batchItem_t* items, int nbItems, const LZ4_batchOptions_t* options);
+
+/*! LZ4_decompress_batch() :
+ *  Decompresses `nbItems` independent blocks, like LZ4_decompress_safe() called on each of them.
+ *  Each item's `result` is the decompressed size, or a negative value if that block is malformed.
+ *  When sharded, blocks are dealt largest first to the least loaded shard (by compressed size),
+ *  so shards finish at about the same time. Items are never reordered in `items`.
+ *  Within a shard, the next block's first bytes are prefetched while the current one is decoded,
+ *  which helps batches of small blocks scattered in memory.
+ * @return : the number of items which failed */
+LZ4LIB_API int LZ4_decompress_batch(LZ4_batchItem_t* items, int nbItems, const LZ4_batchOptions_t* options);
+
+/*! LZ4_compress_large() :
+ *  One-shot compression of inputs of any size, including beyond LZ4_MAX_INPUT_SIZE.
+ *  `src` is cut into blocks of 4 MB, each using the previous 64 KB as a dictionary
+ *  (decodable as linked blocks), and written as an LZ4 frame
+ *  (see doc/lz4_Frame_format.md, no checksum), which LZ4F_decompress() and the lz4 command line can decode.
+ *  Blocks which don't compress are stored as is, so `dstCapacity >= LZ4_compressBound_large(srcSize)` always succeeds.
+ *  `options` (may be NULL) sets acceleration and hashLog, and lets blocks be compressed in parallel (see LZ4_batchOptions_t) :
+ *  the result doesn't depend on the number of threads.
+ *  Memory used : one stream per thread, plus 4 MB per thread when nbThreads > 1.
+ * @return : the compressed size, or 0 on failure (dst too small, out of memory, invalid hashLog) */
+LZ4LIB_API size_t LZ4_compress_large(const char* src, char* dst, size_t srcSize, size_t dstCapacity, const LZ4_batchOptions_t* options);
+
+/*! LZ4_compressBound_large() :
+ * @return : maximum output size of LZ4_compress_large(), or 0 if `srcSize` is too large for size_t */
+LZ4LIB_API size_t LZ4_compressBound_large(size_t srcSize);
+
+/*! LZ4_decompress_large() :
+ *  Decompresses the output of LZ4_compress_large(), block after block, in bounded memory (no allocation).
+ *  Only frames laid out as LZ4_compress_large() writes them are accepted : use lz4frame.h for other frames.
+ * @return : the decompressed size,
+ *           or LZ4_LARGE_ERROR if `src` is malformed or `dstCapacity` is too small */
+#define LZ4_LARGE_ERROR ((size_t)-1)
+LZ4LIB_API size_t LZ4_decompress_large(const char* src, char* dst, size_t compressedSize, size_t dstCapacity);
+
 #endif
 
 /*-************************************
@@ -489,6 +677,8 @@ LZ4LIB_API void LZ4_attach_dictionary(LZ4_stream_t *working_stream, const LZ4_st
 #define LZ4_HASHLOG   (LZ4_MEMORY_USAGE-2)
 #define LZ4_HASHTABLESIZE (1 << LZ4_MEMORY_USAGE)
 #define LZ4_HASH_SIZE_U32 (1 << LZ4_HASHLOG)       /* required as macro for static allocation */
+#define LZ4_HASHLOG_MIN 10   /* range of LZ4_initStreamHashLog() */
+#define LZ4_HASHLOG_MAX 20
 
 #if defined(__cplusplus) || (defined (__STDC_VERSION__) && (__STDC_VERSION__ >= 199901L) /* C99 */)
 #include <stdint.h>
@@ -502,6 +692,7 @@ struct LZ4_stream_t_internal {
     const uint8_t* dictionary;
     const LZ4_stream_t_internal* dictCtx;
     uint32_t dictSize;
+    uint32_t hashLog;   /* 0 : LZ4_HASHLOG. Set by LZ4_initStreamHashLog() */
 };
 
 typedef struct {
@@ -522,6 +713,7 @@ struct LZ4_stream_t_internal {
     const unsigned char* dictionary;
     const LZ4_stream_t_internal* dictCtx;
     unsigned int dictSize;
+    unsigned int hashLog;   /* 0 : LZ4_HASHLOG. Set by LZ4_initStreamHashLog() */
 };
 
 typedef struct {
@@ -543,6 +735,7 @@ typedef struct {
  */
 #define LZ4_STREAMSIZE_U64 ((1 << (LZ4_MEMORY_USAGE-3)) + 4)
 #define LZ4_STREAMSIZE     (LZ4_STREAMSIZE_U64 * sizeof(unsigned long long))
+#define LZ4_STREAMSIZE_HASHLOG(hashLog)   (LZ4_STREAMSIZE + (((hashLog) > LZ4_HASHLOG) ? ((size_t)4 << (hashLog)) : 0))   /* tables larger than the default one follow the LZ4_stream_t */
 union LZ4_stream_u {
     unsigned long long table[LZ4_STREAMSIZE_U64];
     LZ4_stream_t_internal internal_donotuse;
@@ -198,6 +198,8 @@ static void LZ4F_writeLE64 (void* dst, U64 value64)
 static const size_t minFHSize = 7;
 static const size_t maxFHSize = LZ4F_HEADER_SIZE_MAX;   /* 19 */
 static const size_t BHSize = 4;
+static const size_t minSampledBlockSize = 1 KB;    /* smaller blocks are always compressed, see skipIncompressible */
+static const int restartDictSize = 64;            /* see LZ4F_restartDict() */
 
 
 /*-************************************
@@ -711,19 +713,39 @@ size_t LZ4F_compressBound(size_t srcSize, const LZ4F_preferences_t* preferencesP
 typedef int (*compressFunc_t)(void* ctx, const char* src, char* dst, int srcSize, int dstSize, int level, const LZ4F_CDict* cdict);
 
 
+/*! LZ4F_restartDict() :
+ *  a linked block stored as is, without running the compressor, is missing from the stream's history :
+ *  restart it from the end of that block, which the decoder has right before the next one */
+static void LZ4F_restartDict(LZ4F_cctx_t* cctxPtr, const void* blockEnd)
+{
+    const char* const dict = (const char*)blockEnd - restartDictSize;
+    if (cctxPtr->prefs.compressionLevel < LZ4HC_CLEVEL_MIN) {
+        LZ4_loadDict((LZ4_stream_t*)(cctxPtr->lz4CtxPtr), dict, restartDictSize);
+    } else {
+        LZ4_loadDictHC((LZ4_streamHC_t*)(cctxPtr->lz4CtxPtr), dict, restartDictSize);
+        LZ4_favorDecompressionSpeed((LZ4_streamHC_t*)(cctxPtr->lz4CtxPtr), (int)cctxPtr->prefs.favorDecSpeed);
+    }
+}
+
 /*! LZ4F_makeBlock():
  *  compress a single block, add header and checksum
  *  assumption : dst buffer capacity is >= srcSize */
-static size_t LZ4F_makeBlock(void* dst, const void* src, size_t srcSize,
-                             compressFunc_t compress, void* lz4ctx, int level,
-                             const LZ4F_CDict* cdict, LZ4F_blockChecksum_t crcFlag)
+static size_t LZ4F_makeBlock(LZ4F_cctx_t* cctxPtr, void* dst, const void* src, size_t srcSize,
+                             compressFunc_t compress)
 {
     BYTE* const cSizePtr = (BYTE*)dst;
-    U32 cSize = (U32)compress(lz4ctx, (const char*)src, (char*)(cSizePtr+4),
-                                      (int)(srcSize), (int)(srcSize-1),
-                                      level, cdict);
+    LZ4F_blockChecksum_t const crcFlag = cctxPtr->prefs.frameInfo.blockChecksumFlag;
+    U32 cSize = 0;
+    if ( (!cctxPtr->prefs.skipIncompressible) || (srcSize < minSampledBlockSize)
+      || LZ4_isCompressible((const char*)src, (int)srcSize) ) {
+        cSize = (U32)compress(cctxPtr->lz4CtxPtr, (const char*)src, (char*)(cSizePtr+4),
+                              (int)(srcSize), (int)(srcSize-1),
+                              cctxPtr->prefs.compressionLevel, cctxPtr->cdict);
+    } else if (cctxPtr->prefs.frameInfo.blockMode == LZ4F_blockLinked) {
+        LZ4F_restartDict(cctxPtr, (const BYTE*)src + srcSize);
+    }
     LZ4F_writeLE32(cSizePtr, cSize);
-    if (cSize == 0) {  /* compression failed */
+    if (cSize == 0) {  /* compression failed, or skipped */
         cSize = (U32)srcSize;
         LZ4F_writeLE32(cSizePtr, cSize | LZ4F_BLOCKUNCOMPRESSED_FLAG);
         memcpy(cSizePtr+4, src, srcSize);
@@ -832,9 +854,7 @@ size_t LZ4F_compressUpdate(LZ4F_cctx* cctxPtr,
             memcpy(cctxPtr->tmpIn + cctxPtr->tmpInSize, srcBuffer, sizeToCopy);
             srcPtr += sizeToCopy;
 
-            dstPtr += LZ4F_makeBlock(dstPtr, cctxPtr->tmpIn, blockSize,
-                                     compress, cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel,
-                                     cctxPtr->cdict, cctxPtr->prefs.frameInfo.blockChecksumFlag);
+            dstPtr += LZ4F_makeBlock(cctxPtr, dstPtr, cctxPtr->tmpIn, blockSize, compress);
 
             if (cctxPtr->prefs.frameInfo.blockMode==LZ4F_blockLinked) cctxPtr->tmpIn += blockSize;
             cctxPtr->tmpInSize = 0;
@@ -844,18 +864,14 @@ size_t LZ4F_compressUpdate(LZ4F_cctx* cctxPtr,
     while ((size_t)(srcEnd - srcPtr) >= blockSize) {
         /* compress full blocks */
         lastBlockCompressed = fromSrcBuffer;
-        dstPtr += LZ4F_makeBlock(dstPtr, srcPtr, blockSize,
-                                 compress, cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel,
-                                 cctxPtr->cdict, cctxPtr->prefs.frameInfo.blockChecksumFlag);
+        dstPtr += LZ4F_makeBlock(cctxPtr, dstPtr, srcPtr, blockSize, compress);
         srcPtr += blockSize;
     }
 
     if ((cctxPtr->prefs.autoFlush) && (srcPtr < srcEnd)) {
         /* compress remaining input < blockSize */
         lastBlockCompressed = fromSrcBuffer;
-        dstPtr += LZ4F_makeBlock(dstPtr, srcPtr, srcEnd - srcPtr,
-                                 compress, cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel,
-                                 cctxPtr->cdict, cctxPtr->prefs.frameInfo.blockChecksumFlag);
+        dstPtr += LZ4F_makeBlock(cctxPtr, dstPtr, srcPtr, srcEnd - srcPtr, compress);
         srcPtr  = srcEnd;
     }
 
@@ -917,9 +933,7 @@ size_t LZ4F_flush(LZ4F_cctx* cctxPtr, void* dstBuffer, size_t dstCapacity, const
     compress = LZ4F_selectCompression(cctxPtr->prefs.frameInfo.blockMode, cctxPtr->prefs.compressionLevel);
 
     /* compress tmp buffer */
-    dstPtr += LZ4F_makeBlock(dstPtr, cctxPtr->tmpIn, cctxPtr->tmpInSize,
-                             compress, cctxPtr->lz4CtxPtr, cctxPtr->prefs.compressionLevel,
-                             cctxPtr->cdict, cctxPtr->prefs.frameInfo.blockChecksumFlag);
+    dstPtr += LZ4F_makeBlock(cctxPtr, dstPtr, cctxPtr->tmpIn, cctxPtr->tmpInSize, compress);
     if (cctxPtr->prefs.frameInfo.blockMode==LZ4F_blockLinked) cctxPtr->tmpIn += cctxPtr->tmpInSize;
     cctxPtr->tmpInSize = 0;
 
@@ -1449,12 +1463,12 @@ size_t LZ4F_decompress(LZ4F_dctx* dctx,
         case dstage_copyDirect:   /* uncompressed block */
             {   size_t const minBuffSize = MIN((size_t)(srcEnd-srcPtr), (size_t)(dstEnd-dstPtr));
                 size_t const sizeToCopy = MIN(dctx->tmpInTarget, minBuffSize);
-                memcpy(dstPtr, srcPtr, sizeToCopy);
+                memmove(dstPtr, srcPtr, sizeToCopy);   /* src and dst may overlap when decoding in-place */
                 if (dctx->frameInfo.blockChecksumFlag) {
-                    LZ4_XXH32_update(&dctx->blockChecksum, srcPtr, sizeToCopy);
+                    LZ4_XXH32_update(&dctx->blockChecksum, dstPtr, sizeToCopy);
                 }
                 if (dctx->frameInfo.contentChecksumFlag)
-                    LZ4_XXH32_update(&dctx->LZ4_XXH, srcPtr, sizeToCopy);
+                    LZ4_XXH32_update(&dctx->LZ4_XXH, dstPtr, sizeToCopy);
                 if (dctx->frameInfo.contentSize)
                     dctx->frameRemainingSize -= sizeToCopy;
 
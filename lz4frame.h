@@ -185,10 +185,11 @@ typedef struct {
   int      compressionLevel;    /* 0: default (fast mode); values > LZ4HC_CLEVEL_MAX count as LZ4HC_CLEVEL_MAX; values < 0 trigger "fast acceleration" */
   unsigned autoFlush;           /* 1: always flush; reduces usage of internal buffers */
   unsigned favorDecSpeed;       /* 1: parser favors decompression speed vs compression ratio. Only works for high compression modes (>= LZ4HC_CLEVEL_OPT_MIN) */  /* v1.8.2+ */
-  unsigned reserved[3];         /* must be zero for forward compatibility */
+  unsigned skipIncompressible;  /* 1: blocks LZ4_isCompressible() finds incompressible (already compressed media ...) are stored as is, without trying to compress them */
+  unsigned reserved[2];         /* must be zero for forward compatibility */
 } LZ4F_preferences_t;
 
-#define LZ4F_INIT_PREFERENCES   { LZ4F_INIT_FRAMEINFO, 0, 0, 0, { 0, 0, 0 } }    /* v1.8.3+ */
+#define LZ4F_INIT_PREFERENCES   { LZ4F_INIT_FRAMEINFO, 0, 0, 0, 0, { 0, 0 } }    /* v1.8.3+ */
 
 
 /*-*********************************
@@ -404,6 +405,17 @@ LZ4FLIB_API size_t LZ4F_decompress(LZ4F_dctx* dctx,
                                    const void* srcBuffer, size_t* srcSizePtr,
                                    const LZ4F_decompressOptions_t* dOptPtr);
 
+/*! LZ4F_DECOMPRESS_INPLACE_BUFFER_SIZE() :
+ *  A complete frame can be decoded in-place, in a single LZ4F_decompress() invocation :
+ *  store the frame at the *tail* of a buffer of at least LZ4F_DECOMPRESS_INPLACE_BUFFER_SIZE(decompressedSize) bytes,
+ *  then decode it into the *beginning* of that same buffer, with `dstBuffer` capacity == decompressedSize.
+ *  On top of the block margin (see LZ4_DECOMPRESS_INPLACE_MARGIN() in lz4.h),
+ *  the frame margin accounts for frame header, block headers and checksums, with blocks of at least 64 KB.
+ *  decompressedSize must be known in advance (e.g. from frame content size, or stored by the application).
+ */
+#define LZ4F_DECOMPRESS_INPLACE_MARGIN(decompressedSize)       ((((decompressedSize) / 255) + 32) + ((decompressedSize) >> 13) + LZ4F_HEADER_SIZE_MAX + 16)
+#define LZ4F_DECOMPRESS_INPLACE_BUFFER_SIZE(decompressedSize)  ((decompressedSize) + LZ4F_DECOMPRESS_INPLACE_MARGIN(decompressedSize))
+
 
 /*! LZ4F_resetDecompressionContext() : added in v1.8.0
  *  In case of an error, the context is left in "undefined" state.
@@ -130,6 +130,20 @@ LZ4_FORCE_INLINE void LZ4HC_Insert (LZ4HC_CCtx_internal* hc4, const BYTE* ip)
     hc4->nextToUpdate = target;
 }
 
+#if LZ4_VECTOR_COUNT
+/* index of the highest set bit of a non-zero compare mask (bit n <=> byte n) */
+LZ4_FORCE_INLINE unsigned LZ4_highBit32(U32 val)
+{
+#  if defined(_MSC_VER)
+    unsigned long r;
+    _BitScanReverse(&r, val);
+    return (unsigned)r;
+#  else
+    return 31 - (unsigned)__builtin_clz(val);
+#  endif
+}
+#endif
+
 /** LZ4HC_countBack() :
  * @return : negative value, nb of common bytes before ip/match */
 LZ4_FORCE_INLINE
@@ -141,6 +155,16 @@ int LZ4HC_countBack(const BYTE* const ip, const BYTE* const match,
     assert(min <= 0);
     assert(ip >= iMin); assert((size_t)(ip-iMin) < (1U<<31));
     assert(match >= mMin); assert((size_t)(match - mMin) < (1U<<31));
+#if LZ4_VECTOR_COUNT
+    /* 16 bytes per step, the last mismatch is the highest bit of the inequality mask */
+    while (back - 16 >= min) {
+        __m128i const in = _mm_loadu_si128((const __m128i*)(ip + back - 16));
+        __m128i const prev = _mm_loadu_si128((const __m128i*)(match + back - 16));
+        U32 const neq = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(in, prev)) ^ 0xFFFF;
+        if (neq) return back - (int)(15 - LZ4_highBit32(neq));
+        back -= 16;
+    }
+#endif
     while ( (back > min)
          && (ip[back-1] == match[back-1]) )
             back--;
@@ -936,6 +960,60 @@ void LZ4_attach_HC_dictionary(LZ4_streamHC_t *working_stream, const LZ4_streamHC
     working_stream->internal_donotuse.dictCtx = dictionary_stream != NULL ? &(dictionary_stream->internal_donotuse) : NULL;
 }
 
+/* dictionary blobs (see lz4.c) : base and dictBase are saved as offsets below the dictionary, end above it */
+
+size_t LZ4_sizeofDictBlobHC(const LZ4_streamHC_t* dictStream)
+{
+    const LZ4HC_CCtx_internal* const ctx = &dictStream->internal_donotuse;
+    size_t const dictSize = (ctx->base == NULL) ? 0 : (size_t)(ctx->end - (ctx->base + ctx->dictLimit));
+    return LZ4_DICTBLOB_HEADERSIZE + sizeof(LZ4_streamHC_t) + dictSize;
+}
+
+size_t LZ4_saveDictBlobHC(const LZ4_streamHC_t* dictStream, void* blob, size_t blobCapacity)
+{
+    const LZ4HC_CCtx_internal* const ctx = &dictStream->internal_donotuse;
+    LZ4HC_CCtx_internal* const state = &((LZ4_streamHC_t*)((BYTE*)blob + LZ4_DICTBLOB_HEADERSIZE))->internal_donotuse;
+    const BYTE* dictStart;
+    size_t dictSize;
+
+    if ((ctx->base == NULL) || (ctx->dictCtx != NULL) || (ctx->lowLimit != ctx->dictLimit)) return 0;   /* not primed by LZ4_loadDictHC() */
+    dictStart = ctx->base + ctx->dictLimit;
+    if ((ctx->end < dictStart) || (ctx->dictBase > dictStart)) return 0;
+    dictSize = (size_t)(ctx->end - dictStart);
+    if (dictSize > 64 KB) return 0;
+    if (((uptrval)blob & 7) != 0) return 0;
+    if (blobCapacity < LZ4_sizeofDictBlobHC(dictStream)) return 0;
+
+    LZ4_writeDictBlobHeader(blob, LZ4_DICTBLOB_STREAMHC, sizeof(LZ4_streamHC_t), dictSize,
+                            (U32)dictSize, ctx->dictLimit, (U32)(dictStart - ctx->dictBase));
+    memcpy(state, dictStream, sizeof(LZ4_streamHC_t));
+    state->end = NULL;
+    state->base = NULL;
+    state->dictBase = NULL;
+    if (dictSize) memcpy((BYTE*)state + sizeof(LZ4_streamHC_t), dictStart, dictSize);
+    return LZ4_sizeofDictBlobHC(dictStream);
+}
+
+const LZ4_streamHC_t* LZ4_loadDictBlobHC(void* blob, size_t blobSize)
+{
+    LZ4_dictBlobHeader_t header;
+    LZ4_streamHC_t* const stream = (LZ4_streamHC_t*)((BYTE*)blob + LZ4_DICTBLOB_HEADERSIZE);
+    LZ4HC_CCtx_internal* const state = &stream->internal_donotuse;
+    const BYTE* const dictStart = (const BYTE*)stream + sizeof(LZ4_streamHC_t);
+
+    if (!LZ4_readDictBlobHeader(&header, blob, blobSize, LZ4_DICTBLOB_STREAMHC)) return NULL;
+    if ( (header.stateSize != sizeof(LZ4_streamHC_t))
+      || (header.endOffset != header.dictSize)
+      || (header.baseOffset != state->dictLimit)
+      || (state->lowLimit != state->dictLimit) ) return NULL;
+
+    state->end = dictStart + header.endOffset;
+    state->base = dictStart - header.baseOffset;
+    state->dictBase = dictStart - header.dictBaseOffset;
+    state->dictCtx = NULL;
+    return stream;
+}
+
 /* compression */
 
 static void LZ4HC_setExternalDict(LZ4HC_CCtx_internal* ctxPtr, const BYTE* newBlock)
@@ -347,6 +347,14 @@ int LZ4_compress_HC_extStateHC_fastReset (void* state, const char* src, char* ds
  */
 LZ4LIB_API void LZ4_attach_HC_dictionary(LZ4_streamHC_t *working_stream, const LZ4_streamHC_t *dictionary_stream);
 
+/*! LZ4_saveDictBlobHC(), LZ4_loadDictBlobHC() :
+ *  Same as LZ4_saveDictBlob() and LZ4_loadDictBlob() (see lz4.h), for a dictionary stream prepared by
+ *  LZ4_loadDictHC(), loaded back in O(1) instead of inserting the whole dictionary into the chain table again.
+ *  The loaded stream is used with LZ4_attach_HC_dictionary(). */
+LZ4LIB_API size_t LZ4_sizeofDictBlobHC(const LZ4_streamHC_t* dictStream);
+LZ4LIB_API size_t LZ4_saveDictBlobHC(const LZ4_streamHC_t* dictStream, void* blob, size_t blobCapacity);
+LZ4LIB_API const LZ4_streamHC_t* LZ4_loadDictBlobHC(void* blob, size_t blobSize);
+
 #if defined (__cplusplus)
 }
 #endif
@@ -3,6 +3,7 @@ import sys
 import os, os.path
 import shutil
 import struct
+import plistlib
 
 reload(sys)
 sys.setdefaultencoding('utf-8')
@@ -18,30 +19,176 @@ def lstFilesByDir(_dir,_func=None,recursion=True):
             if _func:
                 _func(fullPath)
 
+xxteaSign = 'god'
+
 def funcXXTEA(path1, path2):
     command = ""
     if sys.platform == 'win32':
-        command = "call xxtea encrypt god key_file=key {0} {1}".format(path1,path2)
+        command = "call xxtea encrypt {0} key_file=key {1} {2}".format(xxteaSign,path1,path2)
     else:
-        command = "./xxtea encrypt god key_file=key {0} {1}".format(path1,path2)
+        command = "./xxtea encrypt {0} key_file=key {1} {2}".format(xxteaSign,path1,path2)
     retCommand = os.system(command)
     if  retCommand != 0:
         raise Exception("error:{0}".format(path1))
 
+# files above this size are encrypted in independent chunks, so FileUtils::openStream can decrypt them progressively
+chunkedThreshold = 1024 * 1024
+chunkSize = 64 * 1024
+
+# layout : sign, uint32 19911107, then (uint32 length, xxtea chunk without its sign) pairs
+def funcXXTEAChunked(path):
+    fileDir = os.path.dirname(path)
+    plainPath = os.path.join(fileDir, '_chunk_plain')
+    cipherPath = os.path.join(fileDir, '_chunk_cipher')
+    srcFile = open(path, 'rb')
+    content = srcFile.read()
+    srcFile.close()
+    out = xxteaSign + struct.pack('I', 19911107)
+    for offset in range(0, len(content), chunkSize):
+        plainFile = open(plainPath, 'wb')
+        plainFile.write(content[offset:offset + chunkSize])
+        plainFile.close()
+        funcXXTEA(plainPath, cipherPath)
+        cipherFile = open(cipherPath, 'rb')
+        chunk = cipherFile.read()
+        cipherFile.close()
+        if not chunk.startswith(xxteaSign):
+            raise Exception("error:{0}".format(path))
+        chunk = chunk[len(xxteaSign):]
+        out += struct.pack('I', len(chunk)) + chunk
+    os.remove(plainPath)
+    os.remove(cipherPath)
+    dstFile = open(path, 'wb')
+    dstFile.write(out)
+    dstFile.close()
+
+# .plist files are compiled to the binary form FileUtils decodes without parsing XML, see CCCompiledPlist.h
+# only the runtime built from CCFileUtils_NEW.cpp reads it : off unless --compile-plist follows the directory
+# layout : 'ccpl', uint32 version, string table (uint32 count, then uint32 length + bytes), then the root value
+compiledPlistMagic = 'ccpl'
+compiledPlistVersion = 1
+
+def encodeCompiledPlist(root):
+    strings = []
+    stringIndexes = {}
+
+    def stringRef(value):
+        if isinstance(value, unicode):
+            value = value.encode('utf-8')
+        index = stringIndexes.get(value)
+        if index is None:
+            index = len(strings)
+            stringIndexes[value] = index
+            strings.append(value)
+        return struct.pack('<I', index)
+
+    # returns None for the types the XML parser skips (date, data)
+    def encodeValue(value):
+        if isinstance(value, bool):
+            return struct.pack('<B', 1 if value else 0)
+        if isinstance(value, (int, long)):
+            # the XML parser reads integers with atoi
+            value = max(-0x80000000, min(0x7FFFFFFF, value))
+            return struct.pack('<Bi', 2, value)
+        if isinstance(value, float):
+            return struct.pack('<Bd', 3, value)
+        if isinstance(value, basestring):
+            return struct.pack('<B', 4) + stringRef(value)
+        if isinstance(value, list):
+            items = [item for item in (encodeValue(v) for v in value) if item is not None]
+            return struct.pack('<BI', 5, len(items)) + ''.join(items)
+        if isinstance(value, dict):
+            items = []
+            for key, v in value.items():
+                item = encodeValue(v)
+                if item is not None:
+                    items.append(stringRef(key) + item)
+            return struct.pack('<BI', 6, len(items)) + ''.join(items)
+        return None
+
+    body = encodeValue(root)
+    table = struct.pack('<I', len(strings)) + ''.join(struct.pack('<I', len(s)) + s for s in strings)
+    return compiledPlistMagic + struct.pack('<I', compiledPlistVersion) + table + body
+
+def compilePlistFunc(path):
+    if os.path.splitext(path)[1] != ".plist":
+        return
+    try:
+        root = plistlib.readPlist(path)
+    except Exception:
+        # not an XML plist, or one plistlib can't read : left to the XML parser
+        return
+    if not isinstance(root, (dict, list)):
+        return
+    dstFile = open(path, 'wb')
+    dstFile.write(encodeCompiledPlist(root))
+    dstFile.close()
+
+# -B4 -BD : 64KB linked blocks, keeps the runtime decoder's side buffers small
 def funcLz4fCompress(path1, path2):
     if sys.platform == 'win32':
-        command = 'call lz4 {0} {1}'.format(path1, path2)
+        command = 'call lz4 -B4 -BD {0} {1}'.format(path1, path2)
         retCommand = os.system(command)
         if retCommand != 0:
             raise Exception("error:{0}".format(path1))
 
+# media files are mostly compressed already : lz4 is only run on the ones isCompressible() expects it to shrink
+mediaExtensions = (".png", ".jpg")
+
+# same estimate as LZ4_isCompressible() in lz4.c : byte distribution, then matches, over 8 samples of 256 bytes
+def isCompressible(content):
+    size = len(content)
+    if size < 12:
+        return False
+    if size > 256 * 8:
+        windows = [((size - 256) * w // 7, 256) for w in range(8)]
+    else:
+        windows = [(0, size)]
+    sampled = sum(length for start, length in windows)
+    data = bytearray(content)
+
+    # collision entropy below 7.5 bits per byte : worth trying
+    histogram = [0] * 256
+    for start, length in windows:
+        for byte in data[start:start + length]:
+            histogram[byte] += 1
+    pairs = sum(count * (count - 1) for count in histogram)
+    if pairs * 181 > sampled * (sampled - 1):
+        return True
+
+    # greedy matches, each saving its length minus about 3 bytes
+    table = [0] * 1024
+    saved = 0
+    for start, length in windows:
+        pos = start
+        end = start + length
+        while pos <= end - 4:
+            sequence = struct.unpack_from('<I', content, pos)[0]
+            h = ((sequence * 2654435761) & 0xFFFFFFFF) >> 22
+            ref = table[h]
+            table[h] = pos
+            if ref < pos and pos - ref <= 65535 and struct.unpack_from('<I', content, ref)[0] == sequence:
+                matchLength = 4
+                while pos + matchLength < end and data[pos + matchLength] == data[ref + matchLength]:
+                    matchLength += 1
+                saved += matchLength - 3
+                pos += matchLength
+            else:
+                pos += 1
+    return saved * 64 >= sampled
+
 def compressFunc(path):
     fileName = os.path.basename(path)
     arr = os.path.splitext(fileName)
     fileDir =os.path.dirname(path)
     if len(arr) != 2:
         return
-    if arr[1] == ".lua" or arr[1] == ".json" or arr[1] == ".plist" or arr[1] == ".ExportJson":
+    compress = arr[1] == ".lua" or arr[1] == ".json" or arr[1] == ".plist" or arr[1] == ".ExportJson"
+    if arr[1] in mediaExtensions:
+        mediaFile = open(path, 'rb')
+        compress = isCompressible(mediaFile.read())
+        mediaFile.close()
+    if compress:
         temp1Path = os.path.join(fileDir, arr[0] + '_temp1') + arr[1]
         temp2Path = os.path.join(fileDir, arr[0] + '_temp2') + arr[1]
         funcLz4fCompress(path, temp1Path)
@@ -49,6 +196,12 @@ def compressFunc(path):
         file_2 = open(temp1Path, 'rb')
         ret_1 = file_1.read()
         ret_2 = file_2.read()
+        if len(ret_2) >= len(ret_1):
+            # not worth compressing; the runtime decodes in-place and relies on frames being smaller than their content
+            file_1.close()
+            file_2.close()
+            os.remove(temp1Path)
+            return
         file_3 = open(temp2Path, 'ab')
         markNum = 19911106
         file_3.write(struct.pack('I', markNum))
@@ -70,8 +223,15 @@ def func(path):
     if arr[1]==".lua":
         funcXXTEA(path,os.path.join(fileDir,arr[0])+".luac")
         os.remove(path)
-    elif arr[1] == ".png" or arr[1] == ".jpg" or arr[1] == ".json" or arr[1] == ".plist" or arr[1] == ".ExportJson":
+    elif arr[1] == ".json" or arr[1] == ".plist" or arr[1] == ".ExportJson":
+        if os.path.getsize(path) > chunkedThreshold:
+            funcXXTEAChunked(path)
+        else:
+            funcXXTEA(path,path)
+    elif arr[1] == ".png" or arr[1] == ".jpg":
         funcXXTEA(path,path)
 
+if '--compile-plist' in sys.argv[2:]:
+    lstFilesByDir(sys.argv[1], compilePlistFunc)
 lstFilesByDir(sys.argv[1], compressFunc)
 lstFilesByDir(sys.argv[1], func)